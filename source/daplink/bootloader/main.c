@@ -38,6 +38,7 @@ __asm void modify_stack_pointer_and_start_app(uint32_t r0_sp, uint32_t r1_pc)
 #define FLAGS_MAIN_30MS           (1 << 1)
 // USB Events
 #define FLAGS_MAIN_PROC_USB             (1 << 9)
+#define FLAGS_MAIN_MSC_PROG             (1 << 10)
 // Used by msc when flashing a new binary
 #define FLAGS_LED_BLINK_30MS      (1 << 6)
 
@@ -93,6 +94,12 @@ void main_blink_msc_led(main_led_state_t permanent)
     return;
 }
 
+// Programming task finished a block of drag-n-drop data
+void main_msc_prog_event(void)
+{
+    os_evt_set(FLAGS_MAIN_MSC_PROG, main_task_id);
+}
+
 void USBD_SignalHandler()
 {
     isr_evt_set(FLAGS_MAIN_PROC_USB, main_task_id);
@@ -154,6 +161,7 @@ __task void main_task(void)
         os_evt_wait_or(   FLAGS_MAIN_90MS               // 90mS tick
                         | FLAGS_MAIN_30MS               // 30mS tick
                         | FLAGS_MAIN_PROC_USB           // process usb events
+                        | FLAGS_MAIN_MSC_PROG           // drag-n-drop data programmed
                         , NO_TIMEOUT );
 
         // Find out what event happened
@@ -163,6 +171,10 @@ __task void main_task(void)
             USBD_Handler();
         }
 
+        if (flags & FLAGS_MAIN_MSC_PROG) {
+            vfs_user_prog_event();
+        }
+
         if (flags & FLAGS_MAIN_90MS) {
             vfs_user_periodic(90); // FLAGS_MAIN_90MS
 
@@ -71,6 +71,13 @@ void main_msc_delay_disconnect_event(void);
 */
 void main_force_msc_disconnect_event(void);
 
+/**
+ Called by the drag-n-drop programming task when it has finished a block of data
+ @param  none
+ @return none
+*/
+void main_msc_prog_event(void);
+
 /**
  Allows other parts of the program to request a LED to toggle state
  @param  permanent decides if the led should remain on or flash
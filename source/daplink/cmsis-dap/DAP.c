@@ -33,6 +33,18 @@
 #endif
 #if (DAP_PACKET_COUNT > 255)
 #error "Maximum Packet Count is 255"
+#endif
+#if (DAP_PACKET_SIZE_FS < 64)
+#error "Minimum Full-Speed Packet Size is 64"
+#endif
+#if (DAP_PACKET_SIZE_FS > DAP_PACKET_SIZE)
+#error "Full-Speed Packet Size must not exceed Packet Size"
+#endif
+#if (DAP_PACKET_COUNT_FS < 1)
+#error "Minimum Full-Speed Packet Count is 1"
+#endif
+#if (DAP_PACKET_COUNT_FS > 255)
+#error "Maximum Full-Speed Packet Count is 255"
 #endif
 
  // Clock Macros
@@ -52,6 +64,20 @@
 
          DAP_Data_t DAP_Data;           // DAP Data
 volatile uint8_t    DAP_TransferAbort;  // Trasfer Abort Flag
+         uint16_t   DAP_PacketSize  = DAP_PACKET_SIZE_FS;   // Packet Size
+         uint8_t    DAP_PacketCount = DAP_PACKET_COUNT_FS;  // Packet Count
+#if (DAP_STATS != 0)
+         DAP_Stats_t DAP_Stats;         // DAP Statistics
+#endif
+
+#if (DAP_SWD != 0)
+// A posted AP read is only carried from one Transfer Block to the next
+// inside one Execute Commands batch, never across packets. Two read
+// blocks rarely fit in the response of a 64 byte full-speed packet, so
+// only the high-speed packet sizes gain from it.
+static   uint8_t    DAP_PostedRead;     // AP read left posted by the last SWD Transfer Block
+static   uint8_t    DAP_BatchLeft;      // Commands left in the Execute Commands batch
+#endif
 
 
 #ifdef DAP_VENDOR
@@ -115,16 +141,26 @@ static uint8_t DAP_Info(uint8_t id, uint8_t *info) {
       break;
     case DAP_ID_CAPABILITIES:
       info[0] = ((DAP_SWD  != 0) ? (1 << 0) : 0) |
-                ((DAP_JTAG != 0) ? (1 << 1) : 0);
+                ((DAP_JTAG != 0) ? (1 << 1) : 0) |
+                ((SWO_UART != 0) ? (1 << 2) : 0);
       length = 1;
       break;
+#if (SWO_UART != 0)
+    case DAP_ID_SWO_BUFFER_SIZE:
+      info[0] = (uint8_t)(SWO_BUFFER_SIZE >>  0);
+      info[1] = (uint8_t)(SWO_BUFFER_SIZE >>  8);
+      info[2] = (uint8_t)(SWO_BUFFER_SIZE >> 16);
+      info[3] = (uint8_t)(SWO_BUFFER_SIZE >> 24);
+      length = 4;
+      break;
+#endif
     case DAP_ID_PACKET_SIZE:
-      info[0] = (uint8_t)(DAP_PACKET_SIZE >> 0);
-      info[1] = (uint8_t)(DAP_PACKET_SIZE >> 8);
+      info[0] = (uint8_t)(DAP_PacketSize >> 0);
+      info[1] = (uint8_t)(DAP_PacketSize >> 8);
       length = 2;
       break;
     case DAP_ID_PACKET_COUNT:
-      info[0] = DAP_PACKET_COUNT;
+      info[0] = DAP_PacketCount;
       length = 1;
       break;
   }
@@ -158,6 +194,35 @@ static inline uint32_t TIMER_EXPIRED (void) {
 #endif
 
 
+#if (DAP_STATS != 0)
+
+// Read free running cycle counter used for the command statistics
+//   return:   processor cycles (wraps at 32 bits)
+uint32_t DAP_StatsTimer (void) {
+#if (__CORTEX_M >= 0x03)
+  return (DWT->CYCCNT);
+#else
+  // No DWT on Cortex-M0/M0+: extend the RTX SysTick by the kernel tick count
+  extern uint32_t os_time;
+  uint32_t ticks;
+  uint32_t val;
+
+  do {
+    ticks = os_time;
+    val   = SysTick->VAL;
+  } while (ticks != os_time);
+  return ((ticks * (SysTick->LOAD + 1)) + (SysTick->LOAD - val));
+#endif
+}
+
+// Clear all command and acknowledge counters
+void DAP_StatsReset (void) {
+  memset(&DAP_Stats, 0, sizeof(DAP_Stats));
+}
+
+#endif
+
+
 // Delay for specified time
 //    delay:  delay time in ms
 void Delayms(uint32_t delay) {
@@ -169,7 +234,8 @@ void Delayms(uint32_t delay) {
 // Process Delay command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Delay(uint8_t *request, uint8_t *response) {
   uint32_t delay;
 
@@ -179,14 +245,15 @@ static uint32_t DAP_Delay(uint8_t *request, uint8_t *response) {
   PIN_DELAY_SLOW(delay);
 
   *response = DAP_OK;
-  return (1);
+  return ((2 << 16) | 1);
 }
 
 
 // Process Host Status command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_HostStatus(uint8_t *request, uint8_t *response) {
 
   switch (*request) {
@@ -198,18 +265,19 @@ static uint32_t DAP_HostStatus(uint8_t *request, uint8_t *response) {
       break;
     default:
       *response = DAP_ERROR;
-      return (1);
+      return ((2 << 16) | 1);
   }
 
   *response = DAP_OK;
-  return (1);
+  return ((2 << 16) | 1);
 }
 
 
 // Process Connect command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
   uint32_t port;
 
@@ -219,6 +287,11 @@ static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
     port = *request;
   }
 
+#if (DAP_STATS != 0)
+  // A debugger session starts with fresh counters
+  DAP_StatsReset();
+#endif
+
   switch (port) {
 #if (DAP_SWD != 0)
     case DAP_PORT_SWD:
@@ -234,44 +307,48 @@ static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
 #endif
     default:
       *response = DAP_PORT_DISABLED;
-      return (1);
+      return ((1 << 16) | 1);
   }
 
   *response = port;
-  return (1);
+  return ((1 << 16) | 1);
 }
 
 
 // Process Disconnect command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Disconnect(uint8_t *response) {
 
   DAP_Data.debug_port = DAP_PORT_DISABLED;
+  DAP_Data.clock_max  = 0;
   PORT_OFF();
 
   *response = DAP_OK;
-  return (1);
+  return ((0 << 16) | 1);
 }
 
 
 // Process Reset Target command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_ResetTarget(uint8_t *response) {
 
   *(response+1) = RESET_TARGET();
   *(response+0) = DAP_OK;
-  return (2);
+  return ((0 << 16) | 2);
 }
 
 
 // Process SWJ Pins command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
   uint32_t value;
@@ -341,33 +418,23 @@ static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
           (PIN_nRESET_IN()    << DAP_SWJ_nRESET);
 
   *response = (uint8_t)value;
-  return (1);
+  return ((6 << 16) | 1);
 }
 #endif
 
 
-// Process SWJ Clock command and prepare response
-//   request:  pointer to request data
-//   response: pointer to response data
-//   return:   number of bytes in response
+// Set SWJ Clock
+//   clock:   requested clock frequency in Hz (not 0)
+//   return:  nominal clock frequency generated in Hz
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
-static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
-  uint32_t clock;
+uint32_t DAP_SetClock(uint32_t clock) {
   uint32_t delay;
-
-  clock = (*(request+0) <<  0) |
-          (*(request+1) <<  8) |
-          (*(request+2) << 16) |
-          (*(request+3) << 24);
-
-  if (clock == 0) {
-    *response = DAP_ERROR;
-    return (1);
-  }
+  uint32_t actual;
 
   if (clock >= MAX_SWJ_CLOCK(DELAY_FAST_CYCLES)) {
     DAP_Data.fast_clock  = 1;
     DAP_Data.clock_delay = 1;
+    actual = MAX_SWJ_CLOCK(DELAY_FAST_CYCLES);
   } else {
     DAP_Data.fast_clock  = 0;
 
@@ -380,10 +447,49 @@ static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
     }
 
     DAP_Data.clock_delay = delay;
+    actual = (CPU_CLOCK/2) / (IO_PORT_WRITE_CYCLES + delay * DELAY_SLOW_CYCLES);
+  }
+
+#if (DAP_SWD_SPI != 0)
+  delay = SWD_SPI_CLOCK(clock);
+  DAP_Data.spi_clock = (delay != 0);
+  if (delay != 0) {
+    actual = delay;
+  }
+#endif
+
+  return (actual);
+}
+#endif
+
+
+// Process SWJ Clock command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
+  uint32_t clock;
+
+  clock = (*(request+0) <<  0) |
+          (*(request+1) <<  8) |
+          (*(request+2) << 16) |
+          (*(request+3) << 24);
+
+  if (clock == 0) {
+    *response = DAP_ERROR;
+    return ((4 << 16) | 1);
+  }
+
+  // A tuned clock limit stays in force until the next disconnect
+  if (DAP_Data.clock_max && (clock > DAP_Data.clock_max)) {
+    clock = DAP_Data.clock_max;
   }
+  DAP_SetClock(clock);
 
   *response = DAP_OK;
-  return (1);
+  return ((4 << 16) | 1);
 }
 #endif
 
@@ -391,7 +497,8 @@ static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
 // Process SWJ Sequence command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
   uint32_t count;
@@ -402,7 +509,7 @@ static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
   SWJ_Sequence(count, request);
 
   *response = DAP_OK;
-  return (1);
+  return (((1 + (count + 7) / 8) << 16) | 1);
 }
 #endif
 
@@ -410,7 +517,8 @@ static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
 // Process SWD Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response) {
   uint8_t value;
@@ -421,7 +529,7 @@ static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response) {
 
   *response = DAP_OK;
 
-  return (1);
+  return ((1 << 16) | 1);
 }
 #endif
 
@@ -429,14 +537,15 @@ static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response) {
 // Process SWD Abort command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_SWD) {
     *response = DAP_ERROR;
-    return (1);
+    return ((5 << 16) | 1);
   }
 
   // Load data (Ignore DAP index)
@@ -449,7 +558,7 @@ static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
   SWD_Transfer(DP_ABORT, &data);
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 #endif
 
@@ -457,15 +566,18 @@ static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
 // Process JTAG Sequence command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
   uint32_t sequence_info;
   uint32_t sequence_count;
+  uint32_t request_count;
   uint32_t response_count;
   uint32_t count;
 
   *response++ = DAP_OK;
+  request_count = 1;
   response_count = 1;
 
   sequence_count = *request++;
@@ -476,13 +588,39 @@ static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
     if (count == 0) count = 64;
     count = (count + 7) / 8;
     request += count;
+    request_count += 1 + count;
     if (sequence_info & JTAG_SEQUENCE_TDO) {
       response += count;
       response_count += count;
     }
   }
 
-  return (response_count);
+  return ((request_count << 16) | response_count);
+}
+#endif
+
+
+// Get size of JTAG Sequence command request
+//   request:  pointer to request data
+//   return:   number of bytes in request
+#if (DAP_JTAG == 0)
+static uint32_t DAP_JTAG_SequenceRequestSize(uint8_t *request) {
+  uint32_t sequence_count;
+  uint32_t request_count;
+  uint32_t count;
+
+  request_count = 1;
+
+  sequence_count = *request++;
+  while (sequence_count--) {
+    count = *request & JTAG_SEQUENCE_TCK;
+    if (count == 0) count = 64;
+    count = (count + 7) / 8;
+    request += 1 + count;
+    request_count += 1 + count;
+  }
+
+  return (request_count);
 }
 #endif
 
@@ -490,7 +628,8 @@ static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
 // Process JTAG Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
   uint32_t count;
@@ -514,7 +653,7 @@ static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
   }
 
   *response = DAP_OK;
-  return (1);
+  return (((1 + count) << 16) | 1);
 }
 #endif
 
@@ -522,14 +661,15 @@ static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
 // Process JTAG IDCODE command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_IDCode(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_JTAG) {
 err:*response = DAP_ERROR;
-    return (1);
+    return ((1 << 16) | 1);
   }
 
   // Device index (JTAP TAP)
@@ -549,7 +689,7 @@ err:*response = DAP_ERROR;
   *(response+3) = (uint8_t)(data >> 16);
   *(response+4) = (uint8_t)(data >> 24);
 
-  return (1+4);
+  return ((1 << 16) | (1+4));
 }
 #endif
 
@@ -557,14 +697,15 @@ err:*response = DAP_ERROR;
 // Process JTAG Abort command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Abort(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_JTAG) {
 err:*response = DAP_ERROR;
-    return (1);
+    return ((5 << 16) | 1);
   }
 
   // Device index (JTAP TAP)
@@ -584,7 +725,7 @@ err:*response = DAP_ERROR;
   JTAG_WriteAbort(data);
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 #endif
 
@@ -592,7 +733,8 @@ err:*response = DAP_ERROR;
 // Process Transfer Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_TransferConfigure(uint8_t *request, uint8_t *response) {
 
   DAP_Data.transfer.idle_cycles = *(request+0);
@@ -601,16 +743,63 @@ static uint32_t DAP_TransferConfigure(uint8_t *request, uint8_t *response) {
 
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 
 
+// Get size of Transfer command request
+//   request:  pointer to request data
+//   return:   number of bytes in request
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+static uint32_t DAP_TransferRequestSize(uint8_t *request) {
+  uint32_t  request_count;
+  uint32_t  request_value;
+  uint8_t  *request_head;
+
+  request_head = request;
+
+  request++;            // DAP index
+
+  request_count = *request++;
+  while (request_count--) {
+    request_value = *request++;
+    if (((request_value & DAP_TRANSFER_RnW) == 0) ||
+        ((request_value & DAP_TRANSFER_MATCH_VALUE) != 0)) {
+      // Write data or match value
+      request += 4;
+    }
+  }
+
+  return (request - request_head);
+}
+#endif
+
+
+// Get size of Transfer Block command request
+//   request:  pointer to request data
+//   return:   number of bytes in request
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+static uint32_t DAP_TransferBlockRequestSize(uint8_t *request) {
+  uint32_t  request_count;
+
+  request_count = *(request+1) | (*(request+2) << 8);
+  if ((request_count == 0) || (*(request+3) & DAP_TRANSFER_RnW)) {
+    return (1+2+1);
+  }
+
+  return (1+2+1 + request_count*4);
+}
+#endif
+
+
 // Process SWD Transfer command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
+  uint32_t  request_size;
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  response_count;
@@ -623,6 +812,7 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  retry;
   uint32_t  data;
 
+  request_size   = DAP_TransferRequestSize(request);
   response_count = 0;
   response_value = 0;
   response_head  = response;
@@ -783,7 +973,7 @@ end:
   *(response_head+0) = (uint8_t)response_count;
   *(response_head+1) = (uint8_t)response_value;
 
-  return (response - response_head);
+  return ((request_size << 16) | (response - response_head));
 }
 #endif
 
@@ -791,9 +981,11 @@ end:
 // Process JTAG Transfer command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
+  uint32_t  request_size;
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  request_ir;
@@ -807,6 +999,7 @@ static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  data;
   uint32_t  ir;
 
+  request_size   = DAP_TransferRequestSize(request);
   response_count = 0;
   response_value = 0;
   response_head  = response;
@@ -982,7 +1175,7 @@ end:
   *(response_head+0) = (uint8_t)response_count;
   *(response_head+1) = (uint8_t)response_value;
 
-  return (response - response_head);
+  return ((request_size << 16) | (response - response_head));
 }
 #endif
 
@@ -990,9 +1183,11 @@ end:
 // Process SWD Transfer Block command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
+  uint32_t  request_size;
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  response_count;
@@ -1000,7 +1195,9 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
   uint8_t  *response_head;
   uint32_t  retry;
   uint32_t  data;
+  uint32_t  chain;
 
+  request_size   = DAP_TransferBlockRequestSize(request);
   response_count = 0;
   response_value = 0;
   response_head  = response;
@@ -1017,17 +1214,26 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
   request_value = *request++;
   if (request_value & DAP_TRANSFER_RnW) {
     // Read register block
+    chain = 0;
     if (request_value & DAP_TRANSFER_APnDP) {
-      // Post AP read
-      retry = DAP_Data.transfer.retry_count;
-      do {
-        response_value = SWD_Transfer(request_value, NULL);
-      } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
-      if (response_value != DAP_TRANSFER_OK) goto end;
+      if (DAP_PostedRead != request_value) {
+        // Post AP read
+        retry = DAP_Data.transfer.retry_count;
+        do {
+          response_value = SWD_Transfer(request_value, NULL);
+        } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+        if (response_value != DAP_TRANSFER_OK) goto end;
+      }
+      // The next command of the batch reads on from the same register
+      chain = DAP_BatchLeft &&
+              (*(request+0) == ID_DAP_TransferBlock) &&
+              (*(request+2) | *(request+3)) &&
+              (*(request+4) == request_value);
     }
+    DAP_PostedRead = 0;
     while (request_count--) {
       // Read DP/AP register
-      if ((request_count == 0) && (request_value & DAP_TRANSFER_APnDP)) {
+      if ((request_count == 0) && (request_value & DAP_TRANSFER_APnDP) && !chain) {
         // Last AP read
         request_value = DP_RDBUFF | DAP_TRANSFER_RnW;
       }
@@ -1043,8 +1249,13 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
       *response++ = (uint8_t)(data >> 24);
       response_count++;
     }
+    if (chain) {
+      // Last AP read was posted for the next block, which skips its own post
+      DAP_PostedRead = request_value;
+    }
   } else {
     // Write register block
+    DAP_PostedRead = 0;
     while (request_count--) {
       // Load data
       data = (*(request+0) <<  0) |
@@ -1072,7 +1283,7 @@ end:
   *(response_head+1) = (uint8_t)(response_count >> 8);
   *(response_head+2) = (uint8_t) response_value;
 
-  return (response - response_head);
+  return ((request_size << 16) | (response - response_head));
 }
 #endif
 
@@ -1080,9 +1291,11 @@ end:
 // Process JTAG Transfer Block command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_TransferBlock(uint8_t *request, uint8_t *response) {
+  uint32_t  request_size;
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  response_count;
@@ -1092,6 +1305,7 @@ static uint32_t DAP_JTAG_TransferBlock(uint8_t *request, uint8_t *response) {
   uint32_t  data;
   uint32_t  ir;
 
+  request_size   = DAP_TransferBlockRequestSize(request);
   response_count = 0;
   response_value = 0;
   response_head  = response;
@@ -1174,7 +1388,7 @@ end:
   *(response_head+1) = (uint8_t)(response_count >> 8);
   *(response_head+2) = (uint8_t) response_value;
 
-  return (response - response_head);
+  return ((request_size << 16) | (response - response_head));
 }
 #endif
 
@@ -1183,18 +1397,20 @@ end:
 // Default function (can be overridden)
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 __weak uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response) {
   *response = ID_DAP_Invalid;
-  return (1);
+  return ((1 << 16) | 1);
 }
 
 
-// Process DAP command and prepare response
+// Dispatch DAP command to its handler and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
-uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_DispatchCommand(uint8_t *request, uint8_t *response) {
   uint32_t num;
 
   if ((*request >= ID_DAP_Vendor0) && (*request <= ID_DAP_Vendor31)) {
@@ -1207,7 +1423,7 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
     case ID_DAP_Info:
       num = DAP_Info(*request, response+1);
       *response = num;
-      return (2 + num);
+      return ((2 << 16) | (2 + num));
     case ID_DAP_HostStatus:
       num = DAP_HostStatus(request, response);
       break;
@@ -1236,10 +1452,16 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
       break;
 #else
     case ID_DAP_SWJ_Pins:
+      *response = DAP_ERROR;
+      return (((1+6) << 16) | 2);
     case ID_DAP_SWJ_Clock:
+      *response = DAP_ERROR;
+      return (((1+4) << 16) | 2);
     case ID_DAP_SWJ_Sequence:
+      num = *request;
+      if (num == 0) num = 256;
       *response = DAP_ERROR;
-      return (2);
+      return (((1+1 + (num + 7) / 8) << 16) | 2);
 #endif
 
 #if (DAP_SWD != 0)
@@ -1249,7 +1471,7 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
 #else
     case ID_DAP_SWD_Configure:
       *response = DAP_ERROR;
-      return (2);
+      return (((1+1) << 16) | 2);
 #endif
 
 #if (DAP_JTAG != 0)
@@ -1264,10 +1486,59 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
       break;
 #else
     case ID_DAP_JTAG_Sequence:
+      *response = DAP_ERROR;
+      return (((1 + DAP_JTAG_SequenceRequestSize(request)) << 16) | 2);
     case ID_DAP_JTAG_Configure:
+      *response = DAP_ERROR;
+      return (((1+1 + *request) << 16) | 2);
     case ID_DAP_JTAG_IDCODE:
       *response = DAP_ERROR;
-      return (2);
+      return (((1+1) << 16) | 2);
+#endif
+
+#if (SWO_UART != 0)
+    case ID_DAP_SWO_Transport:
+      num = SWO_Transport(request, response);
+      break;
+    case ID_DAP_SWO_Mode:
+      num = SWO_Mode(request, response);
+      break;
+    case ID_DAP_SWO_Baudrate:
+      num = SWO_Baudrate(request, response);
+      break;
+    case ID_DAP_SWO_Control:
+      num = SWO_Control(request, response);
+      break;
+    case ID_DAP_SWO_Status:
+      num = SWO_Status(response);
+      break;
+    case ID_DAP_SWO_Data:
+      num = SWO_Data(request, response);
+      break;
+#else
+    case ID_DAP_SWO_Transport:
+    case ID_DAP_SWO_Mode:
+    case ID_DAP_SWO_Control:
+      *response = DAP_ERROR;
+      return (((1+1) << 16) | 2);
+    case ID_DAP_SWO_Baudrate:
+      *(response+0) = 0;        // Baudrate not supported
+      *(response+1) = 0;
+      *(response+2) = 0;
+      *(response+3) = 0;
+      return (((1+4) << 16) | 5);
+    case ID_DAP_SWO_Status:
+      *(response+0) = 0;        // Trace status
+      *(response+1) = 0;        // Trace count
+      *(response+2) = 0;
+      *(response+3) = 0;
+      *(response+4) = 0;
+      return ((1 << 16) | 6);
+    case ID_DAP_SWO_Data:
+      *(response+0) = 0;        // Trace status
+      *(response+1) = 0;        // Trace count
+      *(response+2) = 0;
+      return (((1+2) << 16) | 4);
 #endif
 
     case ID_DAP_TransferConfigure:
@@ -1287,9 +1558,14 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
           break;
 #endif
         default:
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+          num  = DAP_TransferRequestSize(request) << 16;
+#else
+          num  = 0;
+#endif
           *(response+0) = 0;    // Response count
           *(response+1) = 0;    // Response value
-          num = 2;
+          num |= 2;
       }
       break;
 
@@ -1306,10 +1582,15 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
           break;
 #endif
         default:
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+          num  = DAP_TransferBlockRequestSize(request) << 16;
+#else
+          num  = 0;
+#endif
           *(response+0) = 0;    // Response count [7:0]
           *(response+1) = 0;    // Response count[15:8]
           *(response+2) = 0;    // Response value
-          num = 3;
+          num |= 3;
       }
       break;
 
@@ -1327,16 +1608,85 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
 #endif
         default:
           *response = DAP_ERROR;
-          return (2);
+          return (((1+5) << 16) | 2);
       }
       break;
 
     default:
       *(response-1) = ID_DAP_Invalid;
-      return (1);
+      return ((1 << 16) | 1);
   }
 
-  return (1 + num);
+  return ((1 << 16) + 1 + num);
+}
+
+
+// Process DAP command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
+#if (DAP_STATS != 0)
+  uint32_t start;
+  uint32_t num;
+  uint32_t id;
+
+  id = *request;
+  if ((id == ID_DAP_QueueCommands) || (id == ID_DAP_ExecuteCommands)) {
+    // Time the commands of a batch, not the batch itself
+    return DAP_DispatchCommand(request, response);
+  }
+  if ((id >= ID_DAP_Vendor0) && (id <= ID_DAP_Vendor31)) {
+    id = DAP_STATS_VENDOR;
+  } else if (id >= DAP_STATS_VENDOR) {
+    id = DAP_STATS_OTHER;
+  }
+
+  start = DAP_StatsTimer();
+  num = DAP_DispatchCommand(request, response);
+  DAP_Stats.cmd[id].count++;
+  DAP_Stats.cmd[id].cycles += (uint32_t)(DAP_StatsTimer() - start);
+
+  return (num);
+#else
+  return DAP_DispatchCommand(request, response);
+#endif
+}
+
+
+// Execute DAP command (process request and prepare response)
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t DAP_ExecuteCommand(uint8_t *request, uint8_t *response) {
+  uint32_t cnt;
+  uint32_t num;
+  uint32_t n;
+
+  if (*request == ID_DAP_ExecuteCommands) {
+    // Process several commands back to back with one combined response
+    *response++ = *request++;
+    cnt = *request++;
+    *response++ = (uint8_t)cnt;
+    num = (2 << 16) | 2;
+    while (cnt--) {
+#if (DAP_SWD != 0)
+      DAP_BatchLeft = (uint8_t)cnt;
+#endif
+      n = DAP_ProcessCommand(request, response);
+      num      += n;
+      request  += (uint16_t)(n >> 16);
+      response += (uint16_t) n;
+    }
+#if (DAP_SWD != 0)
+    DAP_BatchLeft = 0;
+#endif
+    return (num);
+  }
+
+  return DAP_ProcessCommand(request, response);
 }
 
 
@@ -1354,10 +1704,19 @@ void DAP_Setup(void) {
 #if (DAP_SWD != 0)
   DAP_Data.swd_conf.turnaround  = 1;
 //DAP_Data.swd_conf.data_phase  = 0;
+  DAP_PostedRead = 0;
 #endif
 #if (DAP_JTAG != 0)
 //DAP_Data.jtag_dev.count = 0;
 #endif
 
   DAP_SETUP();  // Device specific setup
+#if ((DAP_STATS != 0) && (__CORTEX_M >= 0x03))
+  // Counters are kept across swd_host sessions, only start the cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+#if (DAP_SWD_SPI != 0)
+  DAP_Data.spi_clock = (SWD_SPI_CLOCK(DAP_DEFAULT_SWJ_CLOCK) != 0);
+#endif
 }
@@ -37,6 +37,14 @@
 #define ID_DAP_JTAG_Sequence            0x14
 #define ID_DAP_JTAG_Configure           0x15
 #define ID_DAP_JTAG_IDCODE              0x16
+#define ID_DAP_SWO_Transport            0x17
+#define ID_DAP_SWO_Mode                 0x18
+#define ID_DAP_SWO_Baudrate             0x19
+#define ID_DAP_SWO_Control              0x1A
+#define ID_DAP_SWO_Status               0x1B
+#define ID_DAP_SWO_Data                 0x1C
+#define ID_DAP_QueueCommands            0x7E
+#define ID_DAP_ExecuteCommands          0x7F
 
 // DAP Vendor Command IDs
 #define ID_DAP_Vendor0                  0x80
@@ -86,6 +94,7 @@
 #define DAP_ID_DEVICE_VENDOR            5
 #define DAP_ID_DEVICE_NAME              6
 #define DAP_ID_CAPABILITIES             0xF0
+#define DAP_ID_SWO_BUFFER_SIZE          0xFD
 #define DAP_ID_PACKET_COUNT             0xFE
 #define DAP_ID_PACKET_SIZE              0xFF
 
@@ -122,6 +131,20 @@
 #define DAP_TRANSFER_ERROR              (1<<3)
 #define DAP_TRANSFER_MISMATCH           (1<<4)
 
+// DAP SWO Trace Transport
+#define DAP_SWO_TRANSPORT_NONE          0       // No transport
+#define DAP_SWO_TRANSPORT_DATA          1       // Read with DAP_SWO_Data command
+
+// DAP SWO Trace Mode
+#define DAP_SWO_OFF                     0
+#define DAP_SWO_UART                    1
+#define DAP_SWO_MANCHESTER              2
+
+// DAP SWO Trace Status
+#define DAP_SWO_CAPTURE_ACTIVE          (1<<0)
+#define DAP_SWO_STREAM_ERROR            (1<<6)
+#define DAP_SWO_BUFFER_OVERRUN          (1<<7)
+
 
 // Debug Port Register Addresses
 #define DP_IDCODE                       0x00    // IDCODE Register (SW Read only)
@@ -148,11 +171,55 @@
 #include "stddef.h"
 #include "stdint.h"
 
+// SWD request and data phases shifted by the SPI peripheral
+#ifndef DAP_SWD_SPI
+#define DAP_SWD_SPI             0
+#endif
+
+// SWO trace capture in UART mode
+#ifndef SWO_UART
+#define SWO_UART                0
+#endif
+
+// SWO trace buffer size in bytes (2^n), set per HDK in daplink_addr.h
+#ifndef DAPLINK_SWO_BUFFER_SIZE
+#define DAPLINK_SWO_BUFFER_SIZE 512
+#endif
+
+// Command and SWD acknowledge counters, enabled per HDK in DAP_config.h
+#ifndef DAP_STATS
+#define DAP_STATS               0
+#endif
+
+#define DAP_STATS_VENDOR        0x20    // Bucket for all Vendor commands
+#define DAP_STATS_OTHER         0x21    // Bucket for unknown commands
+#define DAP_STATS_BUCKETS       0x22    // Number of command buckets
+
+#if (DAP_STATS != 0)
+// DAP Statistics structure
+typedef struct {
+  struct {                                      // Command Buckets
+    uint32_t  count;                            // Number of commands processed
+    uint64_t  cycles;                           // Total processing time in cycles
+  } cmd[DAP_STATS_BUCKETS];
+  uint32_t    swd_ok;                           // SWD OK acknowledges
+  uint32_t    swd_wait;                         // SWD WAIT acknowledges (retries)
+  uint32_t    swd_fault;                        // SWD FAULT acknowledges
+  uint32_t    swd_parity;                       // SWD read data parity errors
+  uint32_t    swd_protocol;                     // SWD invalid acknowledges
+  uint32_t    aborts;                           // Transfer Abort requests
+} DAP_Stats_t;
+#endif
+
 // DAP Data structure
 typedef struct {
   uint8_t     debug_port;                       // Debug Port
   uint8_t     fast_clock;                       // Fast Clock Flag
   uint32_t   clock_delay;                       // Clock Delay
+  uint32_t   clock_max;                         // Clock Limit from clock tuning (0 = none)
+#if (DAP_SWD_SPI != 0)
+  uint8_t     spi_clock;                        // SWD Clock generated by SPI
+#endif
   struct {                                      // Transfer Configuration
     uint8_t   idle_cycles;                      // Idle cycles after transfer
     uint16_t  retry_count;                      // Number of retries after WAIT response
@@ -180,6 +247,11 @@ typedef struct {
 
 extern          DAP_Data_t DAP_Data;            // DAP Data
 extern volatile uint8_t    DAP_TransferAbort;   // Transfer Abort Flag
+extern          uint16_t   DAP_PacketSize;      // Packet Size for the current USB speed
+extern          uint8_t    DAP_PacketCount;     // Packet Count for the current USB speed
+#if (DAP_STATS != 0)
+extern          DAP_Stats_t DAP_Stats;          // DAP Statistics
+#endif
 
 
 // Functions
@@ -191,13 +263,34 @@ extern void     JTAG_WriteAbort (uint32_t data);
 extern uint8_t  JTAG_Transfer   (uint32_t request, uint32_t *data);
 extern uint8_t  SWD_Transfer    (uint32_t request, uint32_t *data);
 
+extern uint32_t SWO_Transport   (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Mode        (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Baudrate    (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Control     (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Status      (uint8_t *response);
+extern uint32_t SWO_Data        (uint8_t *request, uint8_t *response);
+
 extern void     Delayms         (uint32_t delay);
+extern uint32_t DAP_SetClock    (uint32_t clock);
+#if (DAP_STATS != 0)
+extern uint32_t DAP_StatsTimer  (void);
+extern void     DAP_StatsReset  (void);
+#endif
 
 extern uint32_t DAP_ProcessVendorCommand (uint8_t *request, uint8_t *response);
 
 extern uint32_t DAP_ProcessCommand (uint8_t *request, uint8_t *response);
+extern uint32_t DAP_ExecuteCommand (uint8_t *request, uint8_t *response);
 extern void     DAP_Setup (void);
 
+// Packet size and count used when enumerated on a Full-Speed port
+#ifndef DAP_PACKET_SIZE_FS
+#define DAP_PACKET_SIZE_FS      DAP_PACKET_SIZE
+#endif
+#ifndef DAP_PACKET_COUNT_FS
+#define DAP_PACKET_COUNT_FS     DAP_PACKET_COUNT
+#endif
+
 // Configurable delay for clock generation
 #ifndef DELAY_SLOW_CYCLES
 #define DELAY_SLOW_CYCLES       3       // Number of cycles for one iteration
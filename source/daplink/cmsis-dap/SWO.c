@@ -0,0 +1,231 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+#include "DAP_config.h"
+#include "DAP.h"
+
+#if (SWO_UART != 0)
+
+#include "swo.h"
+
+#if ((SWO_BUFFER_SIZE & (SWO_BUFFER_SIZE - 1)) != 0)
+#error "SWO_BUFFER_SIZE must be 2^n"
+#endif
+
+
+// The UART driver fills TraceBuf continuously and reports the number of bytes
+// received since the capture was started. TraceIndexO counts the bytes sent to
+// the host, so the difference of both is the amount of trace data buffered.
+static uint8_t  TraceBuf[SWO_BUFFER_SIZE];      // Trace Buffer
+static uint32_t TraceIndexO;                    // Outgoing Trace Index
+static uint8_t  TraceTransport;                 // Trace Transport
+static uint8_t  TraceMode;                      // Trace Mode
+static uint8_t  TraceStatus;                    // Trace Status
+
+
+// Get number of buffered trace bytes
+//   return: number of bytes, overrun is flagged and the buffer is flushed
+static uint32_t SWO_GetCount (void) {
+  uint32_t index_i;
+  uint32_t count;
+
+  if ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) == 0) {
+    return (0);
+  }
+
+  index_i = swo_uart_count();
+  count   = index_i - TraceIndexO;
+  if (count > SWO_BUFFER_SIZE) {
+    // Oldest data was overwritten before it was read
+    TraceStatus |= DAP_SWO_BUFFER_OVERRUN;
+    TraceIndexO  = index_i;
+    count = 0;
+  }
+
+  return (count);
+}
+
+
+// Process SWO Transport command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Transport (uint8_t *request, uint8_t *response) {
+  uint8_t transport;
+
+  transport = *request;
+  if ((transport <= DAP_SWO_TRANSPORT_DATA) &&
+      ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) == 0)) {
+    TraceTransport = transport;
+    *response = DAP_OK;
+  } else {
+    *response = DAP_ERROR;
+  }
+
+  return ((1 << 16) | 1);
+}
+
+
+// Process SWO Mode command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Mode (uint8_t *request, uint8_t *response) {
+  uint8_t mode;
+
+  mode = *request;
+  if ((mode > DAP_SWO_UART) || (TraceStatus & DAP_SWO_CAPTURE_ACTIVE)) {
+    *response = DAP_ERROR;
+    return ((1 << 16) | 1);
+  }
+
+  if (mode != TraceMode) {
+    if (mode == DAP_SWO_UART) {
+      swo_uart_initialize();
+    } else {
+      swo_uart_uninitialize();
+    }
+    TraceMode = mode;
+  }
+
+  *response = DAP_OK;
+  return ((1 << 16) | 1);
+}
+
+
+// Process SWO Baudrate command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Baudrate (uint8_t *request, uint8_t *response) {
+  uint32_t baudrate;
+
+  baudrate = (*(request+0) <<  0) |
+             (*(request+1) <<  8) |
+             (*(request+2) << 16) |
+             (*(request+3) << 24);
+
+  if ((baudrate != 0) && (TraceMode == DAP_SWO_UART) &&
+      ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) == 0)) {
+    baudrate = swo_uart_set_baudrate(baudrate);
+  } else {
+    baudrate = 0;
+  }
+
+  *response++ = (uint8_t)(baudrate >>  0);
+  *response++ = (uint8_t)(baudrate >>  8);
+  *response++ = (uint8_t)(baudrate >> 16);
+  *response   = (uint8_t)(baudrate >> 24);
+
+  return ((4 << 16) | 4);
+}
+
+
+// Process SWO Control command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Control (uint8_t *request, uint8_t *response) {
+
+  if (*request & 1) {
+    if ((TraceMode != DAP_SWO_UART) || (TraceTransport == DAP_SWO_TRANSPORT_NONE)) {
+      *response = DAP_ERROR;
+      return ((1 << 16) | 1);
+    }
+    if ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) == 0) {
+      TraceIndexO = 0;
+      TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
+      swo_uart_start(TraceBuf, SWO_BUFFER_SIZE);
+    }
+  } else {
+    if (TraceStatus & DAP_SWO_CAPTURE_ACTIVE) {
+      swo_uart_stop();
+      TraceStatus &= ~DAP_SWO_CAPTURE_ACTIVE;
+    }
+  }
+
+  *response = DAP_OK;
+  return ((1 << 16) | 1);
+}
+
+
+// Process SWO Status command and prepare response
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Status (uint8_t *response) {
+  uint32_t count;
+
+  count = SWO_GetCount();
+
+  *response++ = TraceStatus;
+  *response++ = (uint8_t)(count >>  0);
+  *response++ = (uint8_t)(count >>  8);
+  *response++ = (uint8_t)(count >> 16);
+  *response   = (uint8_t)(count >> 24);
+
+  return ((0 << 16) | 5);
+}
+
+
+// Process SWO Data command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_Data (uint8_t *request, uint8_t *response) {
+  uint32_t count;
+  uint32_t n;
+  uint32_t index;
+
+  count = SWO_GetCount();
+
+  n = (*(request+0) << 0) |
+      (*(request+1) << 8);
+  if (count > n) {
+    count = n;
+  }
+  // Command, status and count fill the first 4 bytes of the packet
+  if (count > (uint32_t)(DAP_PacketSize - 4)) {
+    count = DAP_PacketSize - 4;
+  }
+  if (TraceTransport != DAP_SWO_TRANSPORT_DATA) {
+    count = 0;
+  }
+
+  *(response+0) = TraceStatus;
+  *(response+1) = (uint8_t)(count >> 0);
+  *(response+2) = (uint8_t)(count >> 8);
+  response += 3;
+
+  index = TraceIndexO & (SWO_BUFFER_SIZE - 1);
+  n = SWO_BUFFER_SIZE - index;
+  if (n > count) {
+    n = count;
+  }
+  memcpy(response, &TraceBuf[index], n);
+  memcpy(response + n, &TraceBuf[0], count - n);
+  TraceIndexO += count;
+
+  return ((2 << 16) | (3 + count));
+}
+
+#endif  /* (SWO_UART != 0) */
@@ -214,16 +214,161 @@ SWD_TransferFunction(Fast);
 SWD_TransferFunction(Slow);
 
 
+#if (DAP_SWD_SPI != 0)
+
+// Parity of a 32-bit value
+static __inline uint32_t SWD_Parity (uint32_t val) {
+  val ^= val >> 16;
+  val ^= val >> 8;
+  val ^= val >> 4;
+  return ((0x6996 >> (val & 0x0F)) & 1);
+}
+
+// SWD Transfer I/O using the SPI peripheral for the request and data phase
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0]
+//   return:  ACK[2:0]
+static uint8_t SWD_TransferSPI (uint32_t request, uint32_t *data) {
+  uint32_t ack;
+  uint32_t bit;
+  uint32_t val;
+  uint32_t parity;
+
+  uint32_t n;
+
+  /* Packet Request: Start, APnDP, RnW, A2, A3, Parity, Stop, Park */
+  request &= 0x0F;
+  parity = (0x6996 >> request) & 1;
+  PIN_SWD_SPI_ENABLE();
+  SWD_SPI_OUT(0x81 | (request << 1) | (parity << 5));
+  PIN_SWD_SPI_DISABLE();
+
+  /* Turnaround */
+  PIN_SWDIO_OUT_DISABLE();
+  for (n = DAP_Data.swd_conf.turnaround; n; n--) {
+    SW_CLOCK_CYCLE();
+  }
+
+  /* Acknowledge response */
+  SW_READ_BIT(bit);
+  ack  = bit << 0;
+  SW_READ_BIT(bit);
+  ack |= bit << 1;
+  SW_READ_BIT(bit);
+  ack |= bit << 2;
+
+  if (ack == DAP_TRANSFER_OK) {         /* OK response */
+    /* Data transfer */
+    if (request & DAP_TRANSFER_RnW) {
+      /* Read data */
+      PIN_SWD_SPI_ENABLE();
+      val  = SWD_SPI_IN() <<  0;        /* Read RDATA[0:31] */
+      val |= SWD_SPI_IN() <<  8;
+      val |= SWD_SPI_IN() << 16;
+      val |= SWD_SPI_IN() << 24;
+      PIN_SWD_SPI_DISABLE();
+      SW_READ_BIT(bit);                 /* Read Parity */
+      if ((SWD_Parity(val) ^ bit) & 1) {
+        ack = DAP_TRANSFER_ERROR;
+      }
+      if (data) *data = val;
+      /* Turnaround */
+      for (n = DAP_Data.swd_conf.turnaround; n; n--) {
+        SW_CLOCK_CYCLE();
+      }
+      PIN_SWDIO_OUT_ENABLE();
+      n = DAP_Data.transfer.idle_cycles;
+    } else {
+      /* Turnaround */
+      for (n = DAP_Data.swd_conf.turnaround; n; n--) {
+        SW_CLOCK_CYCLE();
+      }
+      PIN_SWDIO_OUT_ENABLE();
+      /* Write data */
+      val = *data;
+      PIN_SWD_SPI_ENABLE();
+      SWD_SPI_OUT(val >>  0);           /* Write WDATA[0:31] */
+      SWD_SPI_OUT(val >>  8);
+      SWD_SPI_OUT(val >> 16);
+      SWD_SPI_OUT(val >> 24);
+      SWD_SPI_OUT(SWD_Parity(val));     /* Write Parity Bit + 7 Idle cycles */
+      PIN_SWD_SPI_DISABLE();
+      n = DAP_Data.transfer.idle_cycles;
+      n = (n > 7) ? (n - 7) : 0;
+    }
+    /* Idle cycles */
+    if (n) {
+      PIN_SWDIO_OUT(0);
+      for (; n; n--) {
+        SW_CLOCK_CYCLE();
+      }
+    }
+    PIN_SWDIO_OUT(1);
+    return (ack);
+  }
+
+  if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT)) {
+    /* WAIT or FAULT response */
+    if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) != 0)) {
+      for (n = 32+1; n; n--) {
+        SW_CLOCK_CYCLE();               /* Dummy Read RDATA[0:31] + Parity */
+      }
+    }
+    /* Turnaround */
+    for (n = DAP_Data.swd_conf.turnaround; n; n--) {
+      SW_CLOCK_CYCLE();
+    }
+    PIN_SWDIO_OUT_ENABLE();
+    if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) == 0)) {
+      PIN_SWDIO_OUT(0);
+      for (n = 32+1; n; n--) {
+        SW_CLOCK_CYCLE();               /* Dummy Write WDATA[0:31] + Parity */
+      }
+    }
+    PIN_SWDIO_OUT(1);
+    return (ack);
+  }
+
+  /* Protocol error */
+  for (n = DAP_Data.swd_conf.turnaround + 32 + 1; n; n--) {
+    SW_CLOCK_CYCLE();                   /* Back off data phase */
+  }
+  PIN_SWDIO_OUT(1);
+  return (ack);
+}
+
+#endif  /* (DAP_SWD_SPI != 0) */
+
+
 // SWD Transfer I/O
 //   request: A[3:2] RnW APnDP
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
 uint8_t  SWD_Transfer(uint32_t request, uint32_t *data) {
+  uint8_t ack;
+
+#if (DAP_SWD_SPI != 0)
+  if (DAP_Data.spi_clock) {
+    ack = SWD_TransferSPI(request, data);
+  } else
+#endif
   if (DAP_Data.fast_clock) {
-    return SWD_TransferFast(request, data);
+    ack = SWD_TransferFast(request, data);
   } else {
-    return SWD_TransferSlow(request, data);
+    ack = SWD_TransferSlow(request, data);
   }
+
+#if (DAP_STATS != 0)
+  switch (ack) {
+    case DAP_TRANSFER_OK:    DAP_Stats.swd_ok++;       break;
+    case DAP_TRANSFER_WAIT:  DAP_Stats.swd_wait++;     break;
+    case DAP_TRANSFER_FAULT: DAP_Stats.swd_fault++;    break;
+    case DAP_TRANSFER_ERROR: DAP_Stats.swd_parity++;   break;
+    default:                 DAP_Stats.swd_protocol++; break;
+  }
+#endif
+
+  return (ack);
 }
 
 
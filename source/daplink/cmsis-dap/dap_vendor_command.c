@@ -15,6 +15,7 @@
  */
 #include "RTL.h"
 #include "stdint.h"
+#include "stdbool.h"
 #include "string.h"
 
 #include "rl_usb.h"
@@ -22,12 +23,355 @@
 #include "DAP_config.h"
 #include "uart.h"
 #include "DAP.h"
+#include "debug_cm.h"
+#include "swd_host.h"
+#include "crc.h"
+#include "flash_manager.h"
+
+#if (DAP_SWD != 0)
+
+// SWD clock tuning steps, tried from the slowest to the fastest
+static const uint32_t swd_tune_clock[] = {
+    100000, 500000, 1000000, 2000000, 3000000, 4000000, 6000000, 8000000, 12000000, 24000000
+};
+
+#define SWD_TUNE_STEPS      (sizeof(swd_tune_clock) / sizeof(swd_tune_clock[0]))
+#define SWD_TUNE_WORDS      16          // IDCODE reads and RAM words per round
+#define SWD_TUNE_ROUNDS     4           // Rounds that have to pass per step
+
+#define SWD_TUNE_CSW        (CSW_RESERVED | CSW_MSTRDBG | CSW_HPROT | CSW_DBGSTAT | CSW_SADDRINC | CSW_SIZE32)
+
+// Kept off the DAP task stack
+static uint32_t swd_tune_buf[SWD_TUNE_WORDS];
+static uint32_t swd_tune_saved[SWD_TUNE_WORDS];
+
+static uint8_t swd_tune_transfer(uint32_t request, uint32_t *data) {
+    uint32_t retry = DAP_Data.transfer.retry_count;
+    uint8_t ack;
+
+    do {
+        ack = SWD_Transfer(request, data);
+    } while ((ack == DAP_TRANSFER_WAIT) && retry--);
+
+    return ack;
+}
+
+// Line reset and clear sticky errors left by a failed step
+static void swd_tune_recover(void) {
+    static const uint8_t line_reset[8] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00};
+    uint32_t data;
+
+    SWJ_Sequence(64, (uint8_t *)line_reset);
+    swd_tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &data);
+    data = STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR;
+    swd_tune_transfer(DP_ABORT, &data);
+}
+
+static uint32_t swd_tune_pattern(uint32_t round, uint32_t n) {
+    uint32_t val = 0xA5A5A5A5 ^ (round * 0x9E3779B9) ^ (n * 0x01010101);
+    // Invert every other word so that each data bit toggles between transfers
+    return (n & 1) ? ~val : val;
+}
+
+// Read or write SWD_TUNE_WORDS words of target RAM
+static uint32_t swd_tune_ram(uint32_t addr, uint32_t *buf, uint32_t write) {
+    uint32_t data;
+    uint32_t n;
+
+    data = addr;
+    if (swd_tune_transfer(DAP_TRANSFER_APnDP | AP_TAR, &data) != DAP_TRANSFER_OK) {
+        return 0;
+    }
+
+    if (write) {
+        for (n = 0; n < SWD_TUNE_WORDS; n++) {
+            if (swd_tune_transfer(DAP_TRANSFER_APnDP | AP_DRW, &buf[n]) != DAP_TRANSFER_OK) {
+                return 0;
+            }
+        }
+        return (swd_tune_transfer(DP_RDBUFF | DAP_TRANSFER_RnW, NULL) == DAP_TRANSFER_OK);
+    }
+
+    // Post the first read, the last word comes from RDBUFF
+    if (swd_tune_transfer(DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW, NULL) != DAP_TRANSFER_OK) {
+        return 0;
+    }
+    for (n = 0; n < SWD_TUNE_WORDS; n++) {
+        data = (n == SWD_TUNE_WORDS - 1) ? (DP_RDBUFF | DAP_TRANSFER_RnW) :
+                                           (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW);
+        if (swd_tune_transfer(data, &buf[n]) != DAP_TRANSFER_OK) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// One stress round at the current clock: IDCODE readback and RAM pattern
+static uint32_t swd_tune_check(uint32_t idcode, uint32_t addr, uint32_t round) {
+    uint32_t data;
+    uint32_t n;
+
+    for (n = 0; n < SWD_TUNE_WORDS; n++) {
+        if (swd_tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &data) != DAP_TRANSFER_OK) {
+            return 0;
+        }
+        if (data != idcode) {
+            return 0;
+        }
+    }
+
+    if (addr == 0) {
+        return 1;
+    }
+
+    for (n = 0; n < SWD_TUNE_WORDS; n++) {
+        swd_tune_buf[n] = swd_tune_pattern(round, n);
+    }
+    if (!swd_tune_ram(addr, swd_tune_buf, 1) || !swd_tune_ram(addr, swd_tune_buf, 0)) {
+        return 0;
+    }
+    for (n = 0; n < SWD_TUNE_WORDS; n++) {
+        if (swd_tune_buf[n] != swd_tune_pattern(round, n)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Find the fastest reliable SWD clock and keep one step below it as limit
+//   addr:    word aligned target RAM address for the pattern test, 0 for IDCODE only
+//   return:  clock frequency in Hz, 0 on error
+static uint32_t swd_tune(uint32_t addr) {
+    uint32_t idcode;
+    uint32_t data;
+    uint32_t actual;
+    uint32_t last;
+    uint32_t best;
+    uint32_t margin;
+    uint32_t step;
+    uint32_t round;
+
+    if (DAP_Data.debug_port != DAP_PORT_SWD) {
+        return 0;
+    }
+
+    // Reference values at the slowest clock
+    DAP_Data.clock_max = 0;
+    DAP_SetClock(swd_tune_clock[0]);
+    swd_tune_recover();
+    if (swd_tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &idcode) != DAP_TRANSFER_OK) {
+        return 0;
+    }
+    if (addr != 0) {
+        data = 0;
+        if (swd_tune_transfer(DP_SELECT, &data) != DAP_TRANSFER_OK) {
+            return 0;
+        }
+        data = SWD_TUNE_CSW;
+        if (swd_tune_transfer(DAP_TRANSFER_APnDP | AP_CSW, &data) != DAP_TRANSFER_OK) {
+            return 0;
+        }
+        if (!swd_tune_ram(addr, swd_tune_saved, 0)) {
+            return 0;
+        }
+    }
+
+    last   = 0;
+    best   = 0;
+    margin = 0;
+    for (step = 0; step < SWD_TUNE_STEPS; step++) {
+        actual = DAP_SetClock(swd_tune_clock[step]);
+        if (actual == last) {
+            // Same setting as the previous step
+            continue;
+        }
+        last = actual;
+        for (round = 0; round < SWD_TUNE_ROUNDS; round++) {
+            if (!swd_tune_check(idcode, addr, round)) {
+                break;
+            }
+        }
+        if (round != SWD_TUNE_ROUNDS) {
+            break;
+        }
+        margin = best;
+        best   = swd_tune_clock[step];
+    }
+
+    // Restore RAM and sticky flags at the slowest clock
+    DAP_SetClock(swd_tune_clock[0]);
+    swd_tune_recover();
+    if ((addr != 0) && !swd_tune_ram(addr, swd_tune_saved, 1)) {
+        best = 0;
+    }
+
+    if (best == 0) {
+        return 0;
+    }
+    if (margin != 0) {
+        best = margin;
+    }
+
+    DAP_Data.clock_max = best;
+    return DAP_SetClock(best);
+}
+
+#define SWD_CRC_CHUNK       256         // Bytes read from the target at a time
+
+// Kept off the DAP task stack
+static uint8_t swd_crc_buf[SWD_CRC_CHUNK];
+
+// CRC32 of target memory, read back with swd_host
+//   crc:     CRC of the preceding region to continue, 0 to start a new one
+//   return:  1 on success, 0 on a failed read or Transfer Abort
+static uint32_t swd_crc(uint32_t addr, uint32_t size, uint32_t *crc) {
+    uint32_t n;
+
+    if (DAP_Data.debug_port != DAP_PORT_SWD) {
+        return 0;
+    }
+
+    DAP_TransferAbort = 0;
+
+    // DAP commands may have changed SELECT and CSW since swd_host last ran
+    swd_invalidate_state();
+
+    while (size > 0) {
+        if (DAP_TransferAbort) {
+            return 0;
+        }
+        n = (size > SWD_CRC_CHUNK) ? SWD_CRC_CHUNK : size;
+        if (!swd_read_memory(addr, swd_crc_buf, n)) {
+            swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+            return 0;
+        }
+        *crc = crc32_continue(*crc, swd_crc_buf, n);
+        addr += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+#define FLASH_OPEN_ERASE_CHIP   0x01    // Open flags: erase the whole chip
+#define FLASH_OPEN_ERASE_SECTOR 0x02    // Open flags: erase sectors as they are written
+#define FLASH_OPEN_ERASE_DIFF   0x04    // Open flags: like FLASH_OPEN_ERASE_SECTOR, skip unchanged sectors
+
+// Set while the vendor commands own flash_manager
+static bool flash_open;
+
+// Start programming with the flash algorithm of the target.  This
+// halts the target in reset and runs DAP_Setup, so a debug session
+// the host had open must be connected again after the close.
+static error_t flash_vendor_open(uint32_t flags) {
+    error_t status;
+
+    if (flash_open || (flash_intf_target == 0)) {
+        return ERROR_FAILURE;
+    }
+
+    // Drag-n-drop may be programming the target from its own task
+    if (!flash_manager_lock()) {
+        return ERROR_TARGET_BUSY;
+    }
+
+    swd_invalidate_state();
+    if (flags & FLASH_OPEN_ERASE_CHIP) {
+        flash_manager_set_erase(FLASH_ERASE_CHIP);
+    } else if (flags & FLASH_OPEN_ERASE_DIFF) {
+        flash_manager_set_erase(FLASH_ERASE_DIFF);
+    } else if (flags & FLASH_OPEN_ERASE_SECTOR) {
+        flash_manager_set_erase(FLASH_ERASE_SECTOR);
+    } else {
+        flash_manager_set_erase(FLASH_ERASE_NONE);
+    }
+    status = flash_manager_init(flash_intf_target);
+    if (ERROR_SUCCESS != status) {
+        // flash_manager is left closed on an init error
+        flash_manager_unlock();
+        return status;
+    }
+
+    flash_open = true;
+    return ERROR_SUCCESS;
+}
+
+static error_t flash_vendor_close(void) {
+    error_t status;
+
+    if (!flash_open) {
+        return ERROR_FAILURE;
+    }
+
+    flash_open = false;
+    status = flash_manager_uninit();
+    flash_manager_unlock();
+    return status;
+}
+
+#endif
+
+#if (DAP_STATS != 0)
+
+#define DAP_STATS_GENERAL   0xFF        // Stats index of the SWD and abort counters
+#define DAP_STATS_RESET     0x01        // Stats control: clear counters after reading
+
+static uint8_t *stats_put32(uint8_t *response, uint32_t val) {
+    *response++ = (uint8_t)(val >>  0);
+    *response++ = (uint8_t)(val >>  8);
+    *response++ = (uint8_t)(val >> 16);
+    *response++ = (uint8_t)(val >> 24);
+    return response;
+}
+
+// Copy counters starting at index into the response
+//   index 0x00..0x21: command buckets, count (4 bytes) and cycles (8 bytes) each
+//   index 0xFF:       cycle clock in Hz and the SWD ok, wait, fault, parity,
+//                     protocol and abort counters (4 bytes each)
+// Returns the number of records that were written
+static uint32_t stats_read(uint32_t index, uint8_t *response) {
+    uint32_t n;
+    uint32_t i;
+
+    if (index == DAP_STATS_GENERAL) {
+        response = stats_put32(response, CPU_CLOCK);
+        response = stats_put32(response, DAP_Stats.swd_ok);
+        response = stats_put32(response, DAP_Stats.swd_wait);
+        response = stats_put32(response, DAP_Stats.swd_fault);
+        response = stats_put32(response, DAP_Stats.swd_parity);
+        response = stats_put32(response, DAP_Stats.swd_protocol);
+        response = stats_put32(response, DAP_Stats.aborts);
+        return 7;
+    }
+
+    if (index >= DAP_STATS_BUCKETS) {
+        return 0;
+    }
+
+    // Command and record count take the first 2 bytes of the packet
+    n = (DAP_PacketSize - 2) / 12;
+    if (n > (DAP_STATS_BUCKETS - index)) {
+        n = DAP_STATS_BUCKETS - index;
+    }
+
+    for (i = index; i < (index + n); i++) {
+        response = stats_put32(response, DAP_Stats.cmd[i].count);
+        response = stats_put32(response, (uint32_t)(DAP_Stats.cmd[i].cycles >>  0));
+        response = stats_put32(response, (uint32_t)(DAP_Stats.cmd[i].cycles >> 32));
+    }
+
+    return n;
+}
+
+#endif
 
 // Process DAP Vendor command and prepare response
 // Default function (can be overridden)
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 // this function is declared as __weak in DAP.c
 uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response) {
 
@@ -38,12 +382,159 @@ uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response) {
         *response = ID_DAP_Vendor0;
         *(response + 1) = len;
         memcpy(response + 2, id_str, len);
-        return (len + 2);
+        return ((1 << 16) | (len + 2));
+    }
+
+#if (DAP_SWD != 0)
+    // SWD clock tuning command
+    //   request:  RAM address for the pattern test (4 bytes, 0 = IDCODE only)
+    //   response: status, tuned SWD clock in Hz (4 bytes)
+    else if (*request == ID_DAP_Vendor1) {
+        uint32_t addr;
+        uint32_t clock;
+
+        addr = (*(request + 1) <<  0) |
+               (*(request + 2) <<  8) |
+               (*(request + 3) << 16) |
+               (*(request + 4) << 24);
+        clock = swd_tune(addr);
+        *response = ID_DAP_Vendor1;
+        *(response + 1) = (clock != 0) ? DAP_OK : DAP_ERROR;
+        *(response + 2) = (uint8_t)(clock >>  0);
+        *(response + 3) = (uint8_t)(clock >>  8);
+        *(response + 4) = (uint8_t)(clock >> 16);
+        *(response + 5) = (uint8_t)(clock >> 24);
+        return ((5 << 16) | 6);
+    }
+#endif
+
+#if (DAP_SWD != 0)
+    // CRC32 of target memory, computed on the probe
+    //   request:  address (4 bytes), size in bytes (4 bytes),
+    //             CRC to continue (4 bytes, 0 for a new region)
+    //   response: status, CRC32 (4 bytes)
+    // SELECT, CSW and TAR are left changed for the host
+    else if (*request == ID_DAP_Vendor3) {
+        uint32_t addr;
+        uint32_t size;
+        uint32_t crc;
+        uint32_t ok;
+
+        addr = (*(request + 1) <<  0) |
+               (*(request + 2) <<  8) |
+               (*(request + 3) << 16) |
+               (*(request + 4) << 24);
+        size = (*(request + 5) <<  0) |
+               (*(request + 6) <<  8) |
+               (*(request + 7) << 16) |
+               (*(request + 8) << 24);
+        crc  = (*(request + 9) <<  0) |
+               (*(request + 10) <<  8) |
+               (*(request + 11) << 16) |
+               (*(request + 12) << 24);
+        ok = swd_crc(addr, size, &crc);
+        *response = ID_DAP_Vendor3;
+        *(response + 1) = ok ? DAP_OK : DAP_ERROR;
+        *(response + 2) = (uint8_t)(crc >>  0);
+        *(response + 3) = (uint8_t)(crc >>  8);
+        *(response + 4) = (uint8_t)(crc >> 16);
+        *(response + 5) = (uint8_t)(crc >> 24);
+        return ((13 << 16) | 6);
+    }
+#endif
+
+#if (DAP_SWD != 0)
+    // Flash programming with the algorithm running on the target, the
+    // response of each command is the error_t status (1 byte)
+    //   open:    flags (1 byte, bit 0 = chip erase, bit 1 = erase sectors
+    //            on their first write, bit 2 = as bit 1 but skip sectors
+    //            that already hold the data), fails with
+    //            ERROR_TARGET_BUSY while a drag-n-drop file is programmed
+    //   program: address (4 bytes), count (1 byte), data (count bytes),
+    //            addresses may go back to data written before, which is
+    //            merged with the flash.  Fails with ERROR_FD_REWRITE if
+    //            it goes back below the 8 address ranges written last,
+    //            or to a 1 KB block that is only part of a sector and
+    //            no longer blank in flash
+    //   erase:   address (4 bytes), size in bytes (4 bytes), erases every
+    //            sector the range touches
+    //   close:   writes out the last page
+    else if (*request == ID_DAP_Vendor4) {
+        *response = ID_DAP_Vendor4;
+        *(response + 1) = flash_vendor_open(*(request + 1));
+        return ((2 << 16) | 2);
+    }
+    else if (*request == ID_DAP_Vendor5) {
+        uint32_t addr;
+        uint32_t count;
+        error_t status;
+
+        addr = (*(request + 1) <<  0) |
+               (*(request + 2) <<  8) |
+               (*(request + 3) << 16) |
+               (*(request + 4) << 24);
+        count = *(request + 5);
+        if (count > (DAP_PacketSize - 6U)) {
+            // Only report the data bytes the packet can hold as consumed
+            count = DAP_PacketSize - 6U;
+            status = ERROR_FAILURE;
+        } else if (!flash_open) {
+            status = ERROR_FAILURE;
+        } else {
+            status = flash_manager_data(addr, request + 6, count);
+        }
+        *response = ID_DAP_Vendor5;
+        *(response + 1) = status;
+        return (((6 + count) << 16) | 2);
+    }
+    else if (*request == ID_DAP_Vendor6) {
+        uint32_t addr;
+        uint32_t size;
+        error_t status;
+
+        addr = (*(request + 1) <<  0) |
+               (*(request + 2) <<  8) |
+               (*(request + 3) << 16) |
+               (*(request + 4) << 24);
+        size = (*(request + 5) <<  0) |
+               (*(request + 6) <<  8) |
+               (*(request + 7) << 16) |
+               (*(request + 8) << 24);
+        status = flash_open ? flash_manager_erase(addr, size) : ERROR_FAILURE;
+        *response = ID_DAP_Vendor6;
+        *(response + 1) = status;
+        return ((9 << 16) | 2);
+    }
+    else if (*request == ID_DAP_Vendor7) {
+        *response = ID_DAP_Vendor7;
+        *(response + 1) = flash_vendor_close();
+        return ((1 << 16) | 2);
+    }
+#endif
+
+#if (DAP_STATS != 0)
+    // Command statistics
+    //   request:  first index (1 byte), control (1 byte, bit 0 = reset after read)
+    //   response: number of records (1 byte), records
+    else if (*request == ID_DAP_Vendor2) {
+        uint32_t n;
+
+        n = stats_read(*(request + 1), response + 2);
+        if (*(request + 2) & DAP_STATS_RESET) {
+            DAP_StatsReset();
+        }
+        *response = ID_DAP_Vendor2;
+        *(response + 1) = (uint8_t)n;
+        if (*(request + 1) == DAP_STATS_GENERAL) {
+            return ((3 << 16) | (2 + (n * 4)));
+        }
+        return ((3 << 16) | (2 + (n * 12)));
     }
+#endif
 
     // else return invalid command
     else {
         *response = ID_DAP_Invalid;
     }
-    return (1);
+    return ((1 << 16) | 1);
 }
@@ -24,47 +24,245 @@
 
 #include "main.h"
 
-#if (USBD_HID_OUTREPORT_MAX_SZ != DAP_PACKET_SIZE)
-#error "USB HID Output Report Size must match DAP Packet Size"
+#if (USBD_HID_OUTREPORT_MAX_SZ != DAP_PACKET_SIZE_FS)
+#error "USB HID Output Report Size must match DAP Full-Speed Packet Size"
 #endif
-#if (USBD_HID_INREPORT_MAX_SZ != DAP_PACKET_SIZE)
-#error "USB HID Input Report Size must match DAP Packet Size"
+#if (USBD_HID_INREPORT_MAX_SZ != DAP_PACKET_SIZE_FS)
+#error "USB HID Input Report Size must match DAP Full-Speed Packet Size"
+#endif
+#if (USBD_HS_ENABLE) && (USBD_HID_HS_OUTREPORT_MAX_SZ != DAP_PACKET_SIZE)
+#error "USB HID High-Speed Output Report Size must match DAP Packet Size"
+#endif
+#if (USBD_HS_ENABLE) && (USBD_HID_HS_INREPORT_MAX_SZ != DAP_PACKET_SIZE)
+#error "USB HID High-Speed Input Report Size must match DAP Packet Size"
+#endif
+#if (USBD_BULK_ENABLE) && (USBD_BULK_WMAXPACKETSIZE != DAP_PACKET_SIZE_FS)
+#error "USB Bulk Endpoint Size must match DAP Full-Speed Packet Size"
+#endif
+#if (USBD_BULK_ENABLE) && (USBD_HS_ENABLE) && (USBD_BULK_HS_ENABLE) && (USBD_BULK_HS_WMAXPACKETSIZE != DAP_PACKET_SIZE)
+#error "USB Bulk High-Speed Endpoint Size must match DAP Packet Size"
+#endif
+
+// Request and response buffers are carved out of one pool each so that
+// the slot size and number of slots can follow the speed the device
+// enumerated at
+#define DAP_PACKET_POOL_SIZE         (DAP_PACKET_COUNT * DAP_PACKET_SIZE)
+#define DAP_PACKET_SLOTS             ((DAP_PACKET_COUNT_FS > DAP_PACKET_COUNT) ? DAP_PACKET_COUNT_FS : DAP_PACKET_COUNT)
+#if ((DAP_PACKET_COUNT_FS * DAP_PACKET_SIZE_FS) > DAP_PACKET_POOL_SIZE)
+#error "DAP Full-Speed Packet Buffers must fit in the High-Speed Packet Buffers"
 #endif
 
-#define FREE_SEM_INIT_COUNT          (DAP_PACKET_COUNT)
 #define PROC_SEM_INIT_COUNT          0
-#define SEND_SEM_INIT_COUNT          0
 
-static          uint8_t  temp_buf                      [DAP_PACKET_SIZE];
-static          uint8_t  USB_Request [DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Request  Buffer
+// Interface a request arrived on and its response must be sent back on
+#define DAP_IF_HID                   0
+#define DAP_IF_BULK                  1
+#define DAP_IF_COUNT                 2
+
+static          uint8_t  USB_RequestPool          [DAP_PACKET_POOL_SIZE];  // Request  Buffer
+static          uint8_t  USB_ResponsePool         [DAP_PACKET_POOL_SIZE];  // Response Buffer
+static          uint8_t  USB_RequestIf            [DAP_PACKET_SLOTS];      // Request  Interface
+static          uint8_t  USB_ResponseIf           [DAP_PACKET_SLOTS];      // Response Interface
+static          uint16_t USB_ResponseSize         [DAP_PACKET_SLOTS];      // Response Size
+static          uint8_t  USB_ResponseDone         [DAP_PACKET_SLOTS];      // Response Sent
 
-static OS_SEM free_sem;
 static OS_SEM proc_sem;
-static OS_SEM send_sem;
+static OS_SEM resp_sem;
 
 static OS_MUT hid_mutex;
 
 
-// Only used by HID out thread
+// Used by HID out thread, Bulk out thread and hid_process
+// so must be synchronized to HID lock
 static uint32_t recv_idx;
+static uint32_t req_free;
+static uint8_t  bulk_out_pending;
 
-// Only used by hid_process
+// Next request to execute and response buffer to fill.  Only
+// changed by hid_process, except when select_packet_size rewinds
+// it while every buffer is free
 static uint32_t proc_idx;
 
-// Used by hid_process and HID out thread
+// Used by hid_process and HID/Bulk in threads
 // so must be synchronized to HID lock
 static uint32_t send_idx;
-static volatile uint8_t  USB_ResponseIdle;
+static uint32_t done_idx;
+static uint32_t hid_in_idx;
+static uint32_t resp_ready;
+static uint32_t resp_busy;
+static uint8_t  USB_ResponseIdle[DAP_IF_COUNT];
+
+static void free_request(void);
+
+static uint8_t *request_buf(uint32_t idx) {
+    return &USB_RequestPool[idx * DAP_PacketSize];
+}
+
+static uint8_t *response_buf(uint32_t idx) {
+    return &USB_ResponsePool[idx * DAP_PacketSize];
+}
+
+// Pick the packet size and count for the speed the device enumerated
+// at.  This is only done while every buffer is free so a packet never
+// changes size while it is queued.  Caller must hold HID lock.
+static void select_packet_size(void) {
+    uint16_t size  = USBD_HighSpeed ? DAP_PACKET_SIZE  : DAP_PACKET_SIZE_FS;
+    uint8_t  count = USBD_HighSpeed ? DAP_PACKET_COUNT : DAP_PACKET_COUNT_FS;
+
+    if ((req_free != DAP_PacketCount) || (resp_busy != 0)) {
+        return;
+    }
+    if ((size == DAP_PacketSize) && (count == DAP_PacketCount)) {
+        return;
+    }
+    // Every response buffer is free so resp_sem holds exactly the old
+    // count and hid_process is not waiting on it.  Adjust its count
+    // rather than re-initialising a semaphore that is in use.
+    while (DAP_PacketCount < count) {
+        os_sem_send(&resp_sem);
+        DAP_PacketCount++;
+    }
+    while (DAP_PacketCount > count) {
+        os_sem_wait(&resp_sem, 0);
+        DAP_PacketCount--;
+    }
+    DAP_PacketSize = size;
+    req_free = count;
+    recv_idx = 0;
+    proc_idx = 0;
+    send_idx = 0;
+    done_idx = 0;
+}
+
+// Take a request buffer from the free pool.  Caller must hold HID lock.
+static uint8_t alloc_request(void) {
+    select_packet_size();
+    if (req_free == 0) {
+        return 0;
+    }
+    req_free--;
+    return 1;
+}
+
+// Hand response buffers back to hid_process once their endpoint is
+// done with them.  Buffers are returned oldest first since hid_process
+// fills them in ring order.  Caller must hold HID lock.
+static void free_responses(void) {
+    while (resp_busy && USB_ResponseDone[done_idx]) {
+        USB_ResponseDone[done_idx] = 0;
+        done_idx = (done_idx + 1) % DAP_PacketCount;
+        resp_busy--;
+        os_sem_send(&resp_sem);
+    }
+}
+
+// Send ready responses in order, each over the interface its request
+// arrived on, for as long as that interface is idle.  The HID endpoint
+// sends straight out of the response buffer and owns it until the host
+// has read the report.  Caller must hold HID lock.
+static void send_responses(void) {
+    uint8_t intf;
+
+    while (resp_ready) {
+        intf = USB_ResponseIf[send_idx];
+        if (!USB_ResponseIdle[intf]) {
+            break;
+        }
+#if (USBD_BULK_ENABLE)
+        if (intf == DAP_IF_BULK) {
+            // The endpoint copies the packet so the buffer is free at once
+            USBD_BULK_DataSend(response_buf(send_idx), USB_ResponseSize[send_idx]);
+            USB_ResponseIdle[intf] = 0;
+            USB_ResponseDone[send_idx] = 1;
+        } else
+#endif
+        {
+            if (usbd_hid_send_report(response_buf(send_idx), DAP_PacketSize)) {
+                USB_ResponseIdle[intf] = 0;
+                hid_in_idx = send_idx;
+            } else if (USBD_Configuration) {
+                // The endpoint is still busy with another report, keep
+                // the response queued and retry on the next IN event
+                break;
+            } else {
+                // Not configured, drop the response
+                USB_ResponseDone[send_idx] = 1;
+            }
+        }
+        send_idx = (send_idx + 1) % DAP_PacketCount;
+        resp_ready--;
+    }
+    free_responses();
+}
+
+#if (USBD_BULK_ENABLE)
+// Move a waiting bulk out packet into the request queue.  While there
+// are no free buffers the packet is left in the endpoint so the host
+// is NAKed instead of losing data.  Caller must hold HID lock.
+static void receive_bulk_request(void) {
+    int32_t len;
+
+    if (!bulk_out_pending) {
+        return;
+    }
+    if (!alloc_request()) {
+        return;
+    }
+    bulk_out_pending = 0;
+    len = USBD_BULK_DataRead(request_buf(recv_idx));
+    if ((len > 0) && (request_buf(recv_idx)[0] == ID_DAP_TransferAbort)) {
+        DAP_TransferAbort = 1;
+#if (DAP_STATS != 0)
+        DAP_Stats.aborts++;
+#endif
+        len = 0;
+    }
+    if (len == 0) {
+        req_free++;
+        return;
+    }
+    USB_RequestIf[recv_idx] = DAP_IF_BULK;
+    recv_idx = (recv_idx + 1) % DAP_PacketCount;
+    os_sem_send(&proc_sem);
+}
+#endif
+
+// Return a request buffer to the free pool.  A bulk out packet held
+// in the endpoint is read by the thread running USB, so only signal it
+// from here.  Caller must hold HID lock.
+static void free_request(void) {
+    req_free++;
+    if (bulk_out_pending) {
+        main_dap_bulk_event();
+    }
+}
+
+// Called on main_dap_bulk_event from the thread running USB
+void dap_bulk_out_event(void) {
+#if (USBD_BULK_ENABLE)
+    os_mut_wait(&hid_mutex, 0xFFFF);
+    receive_bulk_request();
+    os_mut_release(&hid_mutex);
+#endif
+}
 
 // USB HID Callback: when system initializes
 void usbd_hid_init (void) {
+    uint32_t i;
+
     recv_idx = 0;
     proc_idx = 0;
     send_idx = 0;
-    USB_ResponseIdle = 1;
-    os_sem_init(&free_sem, FREE_SEM_INIT_COUNT);
+    done_idx = 0;
+    req_free = DAP_PacketCount;
+    resp_ready = 0;
+    resp_busy = 0;
+    bulk_out_pending = 0;
+    for (i = 0; i < DAP_IF_COUNT; i++) {
+        USB_ResponseIdle[i] = 1;
+    }
     os_sem_init(&proc_sem, PROC_SEM_INIT_COUNT);
-    os_sem_init(&send_sem, SEND_SEM_INIT_COUNT);
+    os_sem_init(&resp_sem, DAP_PacketCount);
     os_mut_init(&hid_mutex);
 }
 
@@ -77,16 +275,14 @@ int usbd_hid_get_report (U8 rtype, U8 rid, U8 *buf, U8 req) {
                 case USBD_HID_REQ_PERIOD_UPDATE:
                     break;
                 case USBD_HID_REQ_EP_INT:
+                    // The host has read the last report, so its buffer
+                    // can be reused and the next response sent
                     os_mut_wait(&hid_mutex, 0xFFFF);
-                    if (os_sem_wait(&send_sem, 0) == OS_R_OK) {
-                        memcpy(buf, USB_Request[send_idx], DAP_PACKET_SIZE);
-                        send_idx = (send_idx + 1) % DAP_PACKET_COUNT;
-                        os_sem_send(&free_sem);
-                        os_mut_release(&hid_mutex);
-                        return (DAP_PACKET_SIZE);
-                    } else {
-                        USB_ResponseIdle = 1;
+                    if (!USB_ResponseIdle[DAP_IF_HID]) {
+                        USB_ResponseDone[hid_in_idx] = 1;
+                        USB_ResponseIdle[DAP_IF_HID] = 1;
                     }
+                    send_responses();
                     os_mut_release(&hid_mutex);
                     break;
             }
@@ -104,15 +300,21 @@ void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req) {
             if (len == 0) break;
             if (buf[0] == ID_DAP_TransferAbort) {
                 DAP_TransferAbort = 1;
+#if (DAP_STATS != 0)
+                DAP_Stats.aborts++;
+#endif
                 break;
             }
             // Store data into request packet buffer
             // If there are no free buffers discard the data
-            if (os_sem_wait(&free_sem, 0) == OS_R_OK) {
-                memcpy(USB_Request[recv_idx], buf, len);
-                recv_idx = (recv_idx + 1) % DAP_PACKET_COUNT;
+            os_mut_wait(&hid_mutex, 0xFFFF);
+            if (alloc_request()) {
+                memcpy(request_buf(recv_idx), buf, len);
+                USB_RequestIf[recv_idx] = DAP_IF_HID;
+                recv_idx = (recv_idx + 1) % DAP_PacketCount;
                 os_sem_send(&proc_sem);
             }
+            os_mut_release(&hid_mutex);
             break;
         case HID_REPORT_FEATURE:
             break;
@@ -121,26 +323,68 @@ void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req) {
 
 // CMSIS-DAP task
 __task void hid_process(void * argv) {
+    uint32_t proc_count;
+    uint32_t n;
+
     while (1) {
 
-        // Process DAP Command
         os_sem_wait(&proc_sem, 0xFFFF);
-        DAP_ProcessCommand(USB_Request[proc_idx], temp_buf);
-        memcpy(USB_Request[proc_idx], temp_buf, DAP_PACKET_SIZE);
-        proc_idx = (proc_idx + 1) % DAP_PACKET_COUNT;
-        os_sem_send(&send_sem);
-
-        // Send input report if USB is idle
-        os_mut_wait(&hid_mutex, 0xFFFF);
-        if (USB_ResponseIdle) {
-            USB_ResponseIdle = 0;
-            os_sem_wait(&send_sem, 0xFFFF);
-            usbd_hid_get_report_trigger(0, USB_Request[send_idx], DAP_PACKET_SIZE);
-            send_idx = (send_idx + 1) % DAP_PACKET_COUNT;
-            os_sem_send(&free_sem);
+        proc_count = 1;
+
+        // Hold back queued commands until the packet ending the
+        // queue arrives or there are no free buffers left
+        n = proc_idx;
+        while (request_buf(n)[0] == ID_DAP_QueueCommands) {
+            request_buf(n)[0] = ID_DAP_ExecuteCommands;
+            if (proc_count >= DAP_PacketCount) {
+                break;
+            }
+            n = (n + 1) % DAP_PacketCount;
+            os_sem_wait(&proc_sem, 0xFFFF);
+            proc_count++;
+        }
+
+        while (proc_count--) {
+
+            // Process DAP Command straight into its response buffer
+            os_sem_wait(&resp_sem, 0xFFFF);
+            USB_ResponseSize[proc_idx] = DAP_ExecuteCommand(request_buf(proc_idx), response_buf(proc_idx)) & 0xFFFF;
+            USB_ResponseIf[proc_idx] = USB_RequestIf[proc_idx];
+
+            // Release the request and send the response if USB is idle
+            os_mut_wait(&hid_mutex, 0xFFFF);
+            proc_idx = (proc_idx + 1) % DAP_PacketCount;
+            resp_ready++;
+            resp_busy++;
+            free_request();
+            send_responses();
+            os_mut_release(&hid_mutex);
         }
-        os_mut_release(&hid_mutex);
 
         main_blink_hid_led(MAIN_LED_OFF);
     }
 }
+
+#if (USBD_BULK_ENABLE)
+// USB Bulk Callback: when system initializes
+void usbd_bulk_init (void) {
+    bulk_out_pending = 0;
+    USB_ResponseIdle[DAP_IF_BULK] = 1;
+}
+
+// USB Bulk Callback: when data is received from the host
+void usbd_bulk_data_out (void) {
+    os_mut_wait(&hid_mutex, 0xFFFF);
+    bulk_out_pending = 1;
+    receive_bulk_request();
+    os_mut_release(&hid_mutex);
+}
+
+// USB Bulk Callback: when the host has read the last response
+void usbd_bulk_data_in (void) {
+    os_mut_wait(&hid_mutex, 0xFFFF);
+    USB_ResponseIdle[DAP_IF_BULK] = 1;
+    send_responses();
+    os_mut_release(&hid_mutex);
+}
+#endif
@@ -22,9 +22,13 @@
 #include "macro.h"
 #include "intelhex.h"
 #include "flash_decoder.h"
+#include "flash_manager.h"
+#include "flash_intf.h"
+#include "crc.h"
 #include "error.h"
 #include "RTL.h"
 #include "compiler.h"
+#include "daplink.h"
 
 typedef enum {
     STREAM_STATE_CLOSED,
@@ -34,7 +38,7 @@ typedef enum {
 } stream_state_t;
 
 typedef bool (*stream_detect_cb_t)(const uint8_t * data, uint32_t size);
-typedef error_t (*stream_open_cb_t)(void * state);
+typedef error_t (*stream_open_cb_t)(void * state, uint32_t size);
 typedef error_t (*stream_write_cb_t)(void * state, const uint8_t * data, uint32_t size);
 typedef error_t (*stream_close_cb_t)(void * state);
 
@@ -51,29 +55,128 @@ typedef struct {
     uint32_t flash_addr;
 } bin_state_t;
 
+#define HEX_SEGMENT_MAX 8
+
 typedef struct {
     bool parsing_complete;
     uint8_t bin_buffer[256];
+    hex_segment_t segments[HEX_SEGMENT_MAX];
 } hex_state_t;
 
+// Compressed image.  A 16 byte header is followed by LZ77 tokens:
+//   0x00-0x7F  literal run, the next (token + 1) bytes are copied
+//   0x80-0xFF  match of ((token & 0x7F) + 3) bytes starting
+//              (offset + 1) bytes back, offset is 2 bytes little endian
+// tools/lz_pack.py creates these files.  The decoder keeps a window of
+// (1 << DAPLINK_LZ_WINDOW_BITS) bytes.  HDKs short on RAM lower this in
+// daplink_addr.h and reject files packed with a larger window.
+#ifndef DAPLINK_LZ_WINDOW_BITS
+#define DAPLINK_LZ_WINDOW_BITS  10
+#endif
+#define LZ_MAGIC            "DLZ\x01"
+#define LZ_HEADER_SIZE      16
+#define LZ_WINDOW_BITS      DAPLINK_LZ_WINDOW_BITS
+#define LZ_WINDOW_SIZE      (1 << LZ_WINDOW_BITS)
+
+typedef enum {
+    LZ_TOKEN,
+    LZ_LITERAL,
+    LZ_OFFSET_LO,
+    LZ_OFFSET_HI,
+} lz_token_state_t;
+
+typedef struct {
+    uint8_t header[LZ_HEADER_SIZE];
+    uint8_t header_pos;
+    bool decoder_open;
+    lz_token_state_t token_state;
+    uint8_t token;
+    uint32_t offset;
+    uint32_t literal_left;
+    uint32_t size_left;     // Bytes still to be decoded
+    uint32_t decoded;       // Bytes decoded so far
+    uint32_t flash_addr;    // Address of window[flush_pos]
+    uint32_t window_pos;
+    uint32_t flush_pos;
+    uint8_t window[LZ_WINDOW_SIZE];
+} lz_state_t;
+
+// Patch against the image already on the target.  A 32 byte header
+// is followed by ops:
+//   0x00-0x7F  literal run, the next (op + 1) bytes are copied
+//   0x80-0xFF  copy of ((((op & 0x7F) << 8) | next byte) + 1) bytes of
+//              the old image from the 4 byte little endian offset after it
+// The new image is rebuilt a block at a time and programmed over the old
+// one, so a block can only copy from sectors that are not erased yet.
+// Copies of whole sectors onto themselves are skipped.
+// tools/patch_pack.py creates these files.  The block size is set by
+// DAPLINK_PATCH_BLOCK_SIZE, HDKs short on RAM lower it in daplink_addr.h
+// and only accept patches made for the same block size.
+#ifndef DAPLINK_PATCH_BLOCK_SIZE
+#define DAPLINK_PATCH_BLOCK_SIZE    1024
+#endif
+#define PATCH_MAGIC         "DPT\x01"
+#define PATCH_HEADER_SIZE   32
+#define PATCH_BLOCK_SIZE    DAPLINK_PATCH_BLOCK_SIZE
+#define PATCH_BLOCK_DEFAULT 1024    // Block size of a header that leaves it 0
+
+typedef enum {
+    PATCH_OP,
+    PATCH_LITERAL,
+    PATCH_COPY_LENGTH,
+    PATCH_COPY_OFFSET,
+} patch_op_state_t;
+
+typedef struct {
+    uint8_t header[PATCH_HEADER_SIZE];
+    uint8_t header_pos;
+    bool decoder_open;
+    patch_op_state_t op_state;
+    uint8_t offset_pos;
+    uint32_t length;        // Bytes left in the current literal or copy
+    uint32_t offset;        // Old image offset of the current copy
+    uint32_t image_addr;    // Address of the old and the new image
+    uint32_t base_size;     // Size of the old image
+    uint32_t sector_size;   // Erase size the patch was made for
+    uint32_t size_left;     // Bytes still to be rebuilt
+    uint32_t crc;           // CRC of the bytes rebuilt so far
+    uint32_t block_addr;    // Address of block[0]
+    uint32_t block_pos;
+    uint8_t block[PATCH_BLOCK_SIZE];
+} patch_state_t;
+
 typedef union {
      bin_state_t bin;
      hex_state_t hex;
+     lz_state_t lz;
+     patch_state_t patch;
 } shared_state_t;
 
 static bool detect_bin(const uint8_t * data, uint32_t size);
-static error_t open_bin(void * state);
+static error_t open_bin(void * state, uint32_t size);
 static error_t write_bin(void * state, const uint8_t * data, uint32_t size);
 static error_t close_bin(void * state);
 
 static bool detect_hex(const uint8_t * data, uint32_t size);
-static error_t open_hex(void * state);
+static error_t open_hex(void * state, uint32_t size);
 static error_t write_hex(void * state, const uint8_t * data, uint32_t size);
 static error_t close_hex(void * state);
 
+static bool detect_lz(const uint8_t * data, uint32_t size);
+static error_t open_lz(void * state, uint32_t size);
+static error_t write_lz(void * state, const uint8_t * data, uint32_t size);
+static error_t close_lz(void * state);
+
+static bool detect_patch(const uint8_t * data, uint32_t size);
+static error_t open_patch(void * state, uint32_t size);
+static error_t write_patch(void * state, const uint8_t * data, uint32_t size);
+static error_t close_patch(void * state);
+
 stream_t stream[] = {
     {detect_bin, open_bin, write_bin, close_bin},   // STREAM_TYPE_BIN
     {detect_hex, open_hex, write_hex, close_hex},   // STREAM_TYPE_HEX
+    {detect_lz, open_lz, write_lz, close_lz},       // STREAM_TYPE_LZ
+    {detect_patch, open_patch, write_patch, close_patch},   // STREAM_TYPE_PATCH
 };
 COMPILER_ASSERT(ELEMENTS_IN_ARRAY(stream) == STREAM_TYPE_COUNT);
 // STREAM_TYPE_NONE must not be included in count
@@ -108,12 +211,16 @@ stream_type_t stream_type_from_name(const vfs_filename_t filename)
         return STREAM_TYPE_BIN;
     } else if (0 == strncmp("HEX", &filename[8], 3)) {
         return STREAM_TYPE_HEX;
+    } else if (0 == strncmp("LZ ", &filename[8], 3)) {
+        return STREAM_TYPE_LZ;
+    } else if (0 == strncmp("PAT", &filename[8], 3)) {
+        return STREAM_TYPE_PATCH;
     } else {
         return STREAM_TYPE_NONE;
     }
 }
 
-error_t stream_open(stream_type_t stream_type)
+error_t stream_open(stream_type_t stream_type, uint32_t size)
 {
     error_t status;
 
@@ -129,6 +236,11 @@ error_t stream_open(stream_type_t stream_type)
         return ERROR_INTERNAL;
     }
 
+    // The DAP vendor commands may be programming the target
+    if (!flash_manager_lock()) {
+        return ERROR_TARGET_BUSY;
+    }
+
     stream_thread_set();
 
     // Initialize all variables
@@ -136,10 +248,12 @@ error_t stream_open(stream_type_t stream_type)
     state = STREAM_STATE_OPEN;
     current_stream = &stream[stream_type];
 
-    // Initialize the specified stream
-    status = current_stream->open(&shared_state);
+    // Initialize the specified stream.  The stream is not
+    // closed after a failed open so give the flash back now.
+    status = current_stream->open(&shared_state, size);
     if (ERROR_SUCCESS != status) {
         state = STREAM_STATE_ERROR;
+        flash_manager_unlock();
     }
     
     return status;
@@ -180,6 +294,7 @@ error_t stream_close(void)
     // Close stream
     status = current_stream->close(&shared_state);
     state = STREAM_STATE_CLOSED;
+    flash_manager_unlock();
     return status;
 }
 
@@ -190,10 +305,10 @@ static bool detect_bin(const uint8_t * data, uint32_t size)
     return FLASH_DECODER_TYPE_UNKNOWN != flash_decoder_detect_type(data, size, 0, false);
 }
 
-static error_t open_bin(void * state)
+static error_t open_bin(void * state, uint32_t size)
 {
     error_t status;
-    status = flash_decoder_open();
+    status = flash_decoder_open(size);
     return status;
 }
 
@@ -268,7 +383,7 @@ static bool detect_hex(const uint8_t * data, uint32_t size)
     return 1 == validate_hexfile(data);
 }
 
-static error_t open_hex(void * state)
+static error_t open_hex(void * state, uint32_t size)
 {
     error_t status;
     hex_state_t * hex_state = (hex_state_t *)state;
@@ -277,7 +392,8 @@ static error_t open_hex(void * state)
     reset_hex_parser();
     hex_state->parsing_complete = false;
 
-    status = flash_decoder_open();
+    // A full record line carries 16 bytes of data in 45 characters
+    status = flash_decoder_open(size / 45 * 16);
     return status;
 }
 
@@ -287,46 +403,45 @@ static error_t write_hex(void * state, const uint8_t * data, uint32_t size)
     hex_state_t * hex_state = (hex_state_t *)state;
 
     hexfile_parse_status_t parse_status = HEX_PARSE_UNINIT;
-    uint32_t bin_start_address = 0; // Decoded from the hex file, the binary buffer data starts at this address
-    uint32_t bin_buf_written = 0;   // The amount of data in the binary buffer starting at address above
+    uint32_t segment_cnt = 0;       // The number of address ranges decoded into the binary buffer
     uint32_t block_amt_parsed = 0;  // amount of data parsed in the block on the last call
+    uint32_t offset;
+    uint32_t i;
     
     while (1) {
         // try to decode a block of hex data into bin data
-        parse_status = parse_hex_blob(data, size, &block_amt_parsed, hex_state->bin_buffer, sizeof(hex_state->bin_buffer), &bin_start_address, &bin_buf_written);
+        parse_status = parse_hex_blob(data, size, &block_amt_parsed, hex_state->bin_buffer, sizeof(hex_state->bin_buffer),
+                                      hex_state->segments, HEX_SEGMENT_MAX, &segment_cnt);
+
+        // program each address range that was decoded
+        offset = 0;
+        for (i = 0; (i < segment_cnt) && (ERROR_SUCCESS == status); i++) {
+            status = flash_decoder_write(hex_state->segments[i].address, hex_state->bin_buffer + offset, hex_state->segments[i].size);
+            offset += hex_state->segments[i].size;
+        }
+        if (ERROR_SUCCESS != status) {
+            break;
+        }
+
         // the entire block of hex was decoded. This is a simple state
         if (HEX_PARSE_OK == parse_status) {
-            if (bin_buf_written > 0) {
-                status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
-            }
             break;
         }
-        else if (HEX_PARSE_UNALIGNED == parse_status) {
-            if (bin_buf_written > 0) {
-                status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
-                if (ERROR_SUCCESS != status) {
-                    break;
-                }
-            }
-
+        else if (HEX_PARSE_BUFFER_FULL == parse_status) {
             // incrememntal offset to finish the block
             size -= block_amt_parsed;
             data += block_amt_parsed;
         }
         else if (HEX_PARSE_EOF == parse_status) {
-            if (bin_buf_written > 0) {
-                status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
-                if (ERROR_SUCCESS == status) {
-                    status = ERROR_SUCCESS_DONE;
-                }
-            }
+            status = ERROR_SUCCESS_DONE;
             break;
         }
         else if (HEX_PARSE_CKSUM_FAIL == parse_status) {
             status = ERROR_HEX_CKSUM;
             break;
         }
-        else if ((HEX_PARSE_UNINIT == parse_status) || (HEX_PARSE_FAILURE == parse_status)) {
+        else if ((HEX_PARSE_UNINIT == parse_status) || (HEX_PARSE_FAILURE == parse_status) ||
+                 (HEX_PARSE_LINE_OVERRUN == parse_status)) {
             util_assert(HEX_PARSE_UNINIT != parse_status);
             status = ERROR_HEX_PARSER;
             break;
@@ -341,3 +456,438 @@ static error_t close_hex(void * state)
     status = flash_decoder_close();
     return status;
 }
+
+/* Compressed file processing */
+
+static bool detect_lz(const uint8_t * data, uint32_t size)
+{
+    return (size >= LZ_HEADER_SIZE) && (0 == memcmp(data, LZ_MAGIC, 4));
+}
+
+static error_t open_lz(void * state, uint32_t size)
+{
+    lz_state_t * lz_state = (lz_state_t *)state;
+    memset(lz_state, 0, sizeof(*lz_state));
+
+    // The flash decoder is opened once the header gives the image size
+    lz_state->decoder_open = false;
+    lz_state->token_state = LZ_TOKEN;
+    return ERROR_SUCCESS;
+}
+
+// Program the part of the window decoded since the last flush
+static error_t flush_lz(lz_state_t * lz_state)
+{
+    error_t status = ERROR_SUCCESS;
+    uint32_t size = lz_state->window_pos - lz_state->flush_pos;
+
+    if (size > 0) {
+        status = flash_decoder_write(lz_state->flash_addr, lz_state->window + lz_state->flush_pos, size);
+        lz_state->flash_addr += size;
+    }
+    if (LZ_WINDOW_SIZE == lz_state->window_pos) {
+        lz_state->window_pos = 0;
+    }
+    lz_state->flush_pos = lz_state->window_pos;
+    return status;
+}
+
+static error_t write_lz(void * state, const uint8_t * data, uint32_t size)
+{
+    error_t status = ERROR_SUCCESS;
+    lz_state_t * lz_state = (lz_state_t *)state;
+    const uint8_t * end = data + size;
+    uint32_t length;
+    uint32_t copy_size;
+    uint32_t src;
+    uint32_t i;
+
+    // Everything after the end of the image is padding
+    if (lz_state->decoder_open && (0 == lz_state->size_left)) {
+        return ERROR_SUCCESS_DONE;
+    }
+
+    // Collect the header and open the flash decoder
+    if (lz_state->header_pos < LZ_HEADER_SIZE) {
+        copy_size = MIN(LZ_HEADER_SIZE - lz_state->header_pos, size);
+        memcpy(lz_state->header + lz_state->header_pos, data, copy_size);
+        lz_state->header_pos += copy_size;
+        data += copy_size;
+        if (lz_state->header_pos < LZ_HEADER_SIZE) {
+            return ERROR_SUCCESS;
+        }
+
+        memcpy(&lz_state->flash_addr, lz_state->header + 4, sizeof(uint32_t));
+        memcpy(&lz_state->size_left, lz_state->header + 8, sizeof(uint32_t));
+        if ((0 != memcmp(lz_state->header, LZ_MAGIC, 4)) ||
+                (lz_state->header[12] > LZ_WINDOW_BITS) ||
+                (0 == lz_state->size_left)) {
+            return ERROR_LZ_FORMAT;
+        }
+
+        status = flash_decoder_open(lz_state->size_left);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+        lz_state->decoder_open = true;
+    }
+
+    while ((data != end) && (lz_state->size_left > 0)) {
+        switch (lz_state->token_state) {
+            case LZ_TOKEN:
+                lz_state->token = *data++;
+                if (lz_state->token & 0x80) {
+                    lz_state->token_state = LZ_OFFSET_LO;
+                } else {
+                    lz_state->literal_left = lz_state->token + 1;
+                    lz_state->token_state = LZ_LITERAL;
+                }
+                continue;
+
+            case LZ_OFFSET_LO:
+                lz_state->offset = *data++;
+                lz_state->token_state = LZ_OFFSET_HI;
+                continue;
+
+            case LZ_OFFSET_HI:
+                lz_state->offset |= *data++ << 8;
+                lz_state->token_state = LZ_TOKEN;
+                if ((lz_state->offset >= LZ_WINDOW_SIZE) || (lz_state->offset >= lz_state->decoded)) {
+                    return ERROR_LZ_FORMAT;
+                }
+
+                // Copy the match one byte at a time since it may overlap itself
+                length = (lz_state->token & 0x7F) + 3;
+                if (length > lz_state->size_left) {
+                    return ERROR_LZ_FORMAT;
+                }
+                src = (lz_state->window_pos - lz_state->offset - 1) & (LZ_WINDOW_SIZE - 1);
+                for (i = 0; i < length; i++) {
+                    lz_state->window[lz_state->window_pos++] = lz_state->window[src];
+                    src = (src + 1) & (LZ_WINDOW_SIZE - 1);
+                    if (LZ_WINDOW_SIZE == lz_state->window_pos) {
+                        status = flush_lz(lz_state);
+                        if (ERROR_SUCCESS != status) {
+                            return status;
+                        }
+                    }
+                }
+                lz_state->decoded += length;
+                lz_state->size_left -= length;
+                continue;
+
+            case LZ_LITERAL:
+                copy_size = MIN(lz_state->literal_left, end - data);
+                copy_size = MIN(copy_size, LZ_WINDOW_SIZE - lz_state->window_pos);
+                if (copy_size > lz_state->size_left) {
+                    return ERROR_LZ_FORMAT;
+                }
+                memcpy(lz_state->window + lz_state->window_pos, data, copy_size);
+                data += copy_size;
+                lz_state->window_pos += copy_size;
+                lz_state->literal_left -= copy_size;
+                lz_state->decoded += copy_size;
+                lz_state->size_left -= copy_size;
+                if (0 == lz_state->literal_left) {
+                    lz_state->token_state = LZ_TOKEN;
+                }
+                if (LZ_WINDOW_SIZE == lz_state->window_pos) {
+                    status = flush_lz(lz_state);
+                    if (ERROR_SUCCESS != status) {
+                        return status;
+                    }
+                }
+                continue;
+        }
+    }
+
+    status = flush_lz(lz_state);
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+    return (0 == lz_state->size_left) ? ERROR_SUCCESS_DONE : ERROR_SUCCESS;
+}
+
+static error_t close_lz(void * state)
+{
+    lz_state_t * lz_state = (lz_state_t *)state;
+
+    if (!lz_state->decoder_open) {
+        return ERROR_SUCCESS;
+    }
+    return flash_decoder_close();
+}
+
+/* Patch file processing */
+
+static bool detect_patch(const uint8_t * data, uint32_t size)
+{
+    return (size >= PATCH_HEADER_SIZE) && (0 == memcmp(data, PATCH_MAGIC, 4));
+}
+
+static error_t open_patch(void * state, uint32_t size)
+{
+    patch_state_t * patch_state = (patch_state_t *)state;
+    memset(patch_state, 0, sizeof(*patch_state));
+
+    // The flash decoder is opened once the old image has been checked
+    patch_state->decoder_open = false;
+    patch_state->op_state = PATCH_OP;
+    return ERROR_SUCCESS;
+}
+
+// Check the header against the target and open the flash decoder
+static error_t start_patch(patch_state_t * patch_state)
+{
+    const flash_intf_t * intf = flash_intf_target;
+    uint32_t base_crc;
+    uint32_t block_size;
+    uint32_t crc = 0;
+    uint32_t addr;
+    uint32_t end;
+    uint32_t size;
+    error_t status;
+
+    memcpy(&patch_state->image_addr, patch_state->header + 4, sizeof(uint32_t));
+    memcpy(&patch_state->base_size, patch_state->header + 8, sizeof(uint32_t));
+    memcpy(&base_crc, patch_state->header + 12, sizeof(uint32_t));
+    memcpy(&patch_state->size_left, patch_state->header + 16, sizeof(uint32_t));
+    memcpy(&patch_state->sector_size, patch_state->header + 24, sizeof(uint32_t));
+    memcpy(&block_size, patch_state->header + 28, sizeof(uint32_t));
+    if (0 == block_size) {
+        block_size = PATCH_BLOCK_DEFAULT;
+    }
+    end = patch_state->image_addr + MAX(patch_state->base_size, patch_state->size_left);
+    if ((0 != memcmp(patch_state->header, PATCH_MAGIC, 4)) ||
+            (PATCH_BLOCK_SIZE != block_size) ||
+            (0 == patch_state->sector_size) ||
+            (0 == patch_state->size_left) ||
+            (end < patch_state->image_addr)) {
+        return ERROR_PATCH_FORMAT;
+    }
+
+    // The old image has to be read back, the bootloader has no target flash
+    if ((0 == intf) || (0 == intf->read)) {
+        return ERROR_FD_UNSUPPORTED_UPDATE;
+    }
+
+    // Target sectors must not be larger than the patch assumes
+    for (addr = patch_state->image_addr; addr < end; addr = ROUND_DOWN(addr, size) + size) {
+        size = intf->erase_sector_size(addr);
+        if (0 == size) {
+            return ERROR_FD_UNSUPPORTED_UPDATE;
+        }
+        if (0 != patch_state->sector_size % size) {
+            return ERROR_PATCH_FORMAT;
+        }
+    }
+
+    // Only apply the patch to the image it was made from
+    for (addr = 0; addr < patch_state->base_size; addr += size) {
+        size = MIN(patch_state->base_size - addr, PATCH_BLOCK_SIZE);
+        status = intf->read(patch_state->image_addr + addr, patch_state->block, size);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+        crc = crc32_continue(crc, patch_state->block, size);
+    }
+    if (crc != base_crc) {
+        return ERROR_PATCH_BASE;
+    }
+
+    status = flash_decoder_open_in_place(patch_state->size_left);
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+    patch_state->decoder_open = true;
+    patch_state->block_addr = patch_state->image_addr;
+    patch_state->block_pos = 0;
+    patch_state->crc = 0;
+    return ERROR_SUCCESS;
+}
+
+// Sectors are erased when the first block in them is written.  The old
+// image is intact from the current block on if it starts a sector,
+// otherwise from the next sector.
+static uint32_t patch_intact_addr(const patch_state_t * patch_state)
+{
+    uint32_t addr = patch_state->block_addr;
+
+    if (0 != addr % patch_state->sector_size) {
+        addr = ROUND_DOWN(addr, patch_state->sector_size) + patch_state->sector_size;
+    }
+    return addr;
+}
+
+// Account for size bytes added to the block and program it once it is full
+static error_t advance_patch(patch_state_t * patch_state, uint32_t size)
+{
+    error_t status;
+
+    patch_state->block_pos += size;
+    patch_state->size_left -= size;
+    if ((patch_state->block_pos < PATCH_BLOCK_SIZE) && (patch_state->size_left > 0)) {
+        return ERROR_SUCCESS;
+    }
+
+    patch_state->crc = crc32_continue(patch_state->crc, patch_state->block, patch_state->block_pos);
+    status = flash_decoder_write(patch_state->block_addr, patch_state->block, patch_state->block_pos);
+    patch_state->block_addr += patch_state->block_pos;
+    patch_state->block_pos = 0;
+    return status;
+}
+
+// Leave size bytes of unchanged sectors alone, only their CRC is needed
+static error_t skip_patch(patch_state_t * patch_state, uint32_t size)
+{
+    uint32_t copy_size;
+    error_t status;
+
+    while (size > 0) {
+        copy_size = MIN(size, PATCH_BLOCK_SIZE);
+        status = flash_intf_target->read(patch_state->block_addr, patch_state->block, copy_size);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+        patch_state->crc = crc32_continue(patch_state->crc, patch_state->block, copy_size);
+        patch_state->block_addr += copy_size;
+        patch_state->offset += copy_size;
+        patch_state->length -= copy_size;
+        patch_state->size_left -= copy_size;
+        size -= copy_size;
+    }
+    return ERROR_SUCCESS;
+}
+
+static error_t write_patch(void * state, const uint8_t * data, uint32_t size)
+{
+    error_t status = ERROR_SUCCESS;
+    patch_state_t * patch_state = (patch_state_t *)state;
+    const uint8_t * end = data + size;
+    uint32_t new_crc;
+    uint32_t copy_size;
+    uint8_t op;
+
+    // Everything after the end of the image is padding
+    if (patch_state->decoder_open && (0 == patch_state->size_left)) {
+        return ERROR_SUCCESS_DONE;
+    }
+
+    // Collect the header, check the old image and open the flash decoder
+    if (patch_state->header_pos < PATCH_HEADER_SIZE) {
+        copy_size = MIN(PATCH_HEADER_SIZE - patch_state->header_pos, size);
+        memcpy(patch_state->header + patch_state->header_pos, data, copy_size);
+        patch_state->header_pos += copy_size;
+        data += copy_size;
+        if (patch_state->header_pos < PATCH_HEADER_SIZE) {
+            return ERROR_SUCCESS;
+        }
+
+        status = start_patch(patch_state);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    while ((data != end) && (patch_state->size_left > 0)) {
+        switch (patch_state->op_state) {
+            case PATCH_OP:
+                op = *data++;
+                if (op & 0x80) {
+                    patch_state->length = (op & 0x7F) << 8;
+                    patch_state->op_state = PATCH_COPY_LENGTH;
+                } else {
+                    patch_state->length = op + 1;
+                    patch_state->op_state = PATCH_LITERAL;
+                    if (patch_state->length > patch_state->size_left) {
+                        return ERROR_PATCH_FORMAT;
+                    }
+                }
+                continue;
+
+            case PATCH_COPY_LENGTH:
+                patch_state->length = (patch_state->length | *data++) + 1;
+                patch_state->offset = 0;
+                patch_state->offset_pos = 0;
+                patch_state->op_state = PATCH_COPY_OFFSET;
+                continue;
+
+            case PATCH_COPY_OFFSET:
+                patch_state->offset |= (uint32_t)*data++ << (8 * patch_state->offset_pos);
+                patch_state->offset_pos++;
+                if (patch_state->offset_pos < 4) {
+                    continue;
+                }
+                patch_state->op_state = PATCH_OP;
+                if ((patch_state->length > patch_state->size_left) ||
+                        (patch_state->offset > patch_state->base_size) ||
+                        (patch_state->length > patch_state->base_size - patch_state->offset)) {
+                    return ERROR_PATCH_FORMAT;
+                }
+
+                // A copy of whole sectors onto themselves is not programmed
+                if ((0 == patch_state->block_pos) &&
+                        (patch_state->image_addr + patch_state->offset == patch_state->block_addr) &&
+                        (0 == patch_state->block_addr % patch_state->sector_size) &&
+                        (patch_state->length >= patch_state->sector_size)) {
+                    status = skip_patch(patch_state, ROUND_DOWN(patch_state->length, patch_state->sector_size));
+                    if (ERROR_SUCCESS != status) {
+                        return status;
+                    }
+                }
+
+                // Read the old image straight into the block
+                while (patch_state->length > 0) {
+                    copy_size = MIN(patch_state->length, PATCH_BLOCK_SIZE - patch_state->block_pos);
+                    if (patch_state->image_addr + patch_state->offset < patch_intact_addr(patch_state)) {
+                        return ERROR_PATCH_FORMAT;
+                    }
+                    status = flash_intf_target->read(patch_state->image_addr + patch_state->offset,
+                                                     patch_state->block + patch_state->block_pos, copy_size);
+                    if (ERROR_SUCCESS != status) {
+                        return status;
+                    }
+                    patch_state->offset += copy_size;
+                    patch_state->length -= copy_size;
+                    status = advance_patch(patch_state, copy_size);
+                    if (ERROR_SUCCESS != status) {
+                        return status;
+                    }
+                }
+                continue;
+
+            case PATCH_LITERAL:
+                copy_size = MIN(patch_state->length, end - data);
+                copy_size = MIN(copy_size, PATCH_BLOCK_SIZE - patch_state->block_pos);
+                memcpy(patch_state->block + patch_state->block_pos, data, copy_size);
+                data += copy_size;
+                patch_state->length -= copy_size;
+                if (0 == patch_state->length) {
+                    patch_state->op_state = PATCH_OP;
+                }
+                status = advance_patch(patch_state, copy_size);
+                if (ERROR_SUCCESS != status) {
+                    return status;
+                }
+                continue;
+        }
+    }
+
+    if (patch_state->size_left > 0) {
+        return ERROR_SUCCESS;
+    }
+
+    // The last block has been programmed, check the result
+    memcpy(&new_crc, patch_state->header + 20, sizeof(uint32_t));
+    return (patch_state->crc == new_crc) ? ERROR_SUCCESS_DONE : ERROR_PATCH_FORMAT;
+}
+
+static error_t close_patch(void * state)
+{
+    patch_state_t * patch_state = (patch_state_t *)state;
+
+    if (!patch_state->decoder_open) {
+        return ERROR_SUCCESS;
+    }
+    return flash_decoder_close();
+}
@@ -26,6 +26,8 @@ typedef enum {
 
     STREAM_TYPE_BIN = STREAM_TYPE_START,
     STREAM_TYPE_HEX,
+    STREAM_TYPE_LZ,
+    STREAM_TYPE_PATCH,
 
     // Add new stream types here
 
@@ -40,7 +42,8 @@ stream_type_t stream_start_identify(const uint8_t* data, uint32_t size);
 // Stateless function to identify a filestream by its name
 stream_type_t stream_type_from_name(const vfs_filename_t filename);
 
-error_t stream_open(stream_type_t stream_type);
+// size is the file size in bytes, 0 if not known yet
+error_t stream_open(stream_type_t stream_type, uint32_t size);
 
 error_t stream_write(const uint8_t * data, uint32_t size);
 
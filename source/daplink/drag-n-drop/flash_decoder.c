@@ -53,6 +53,8 @@ static uint32_t initial_addr;
 static uint32_t current_addr;
 static bool flash_initialized;
 static bool initial_addr_set;
+static uint32_t image_size;
+static bool in_place;
 
 flash_decoder_type_t flash_decoder_detect_type(const uint8_t * data, uint32_t size, uint32_t addr, bool addr_valid)
 {
@@ -144,9 +146,9 @@ error_t flash_decoder_get_flash(flash_decoder_type_t type, uint32_t addr, bool a
     return status;
 }
 
-error_t flash_decoder_open(void)
+error_t flash_decoder_open(uint32_t size)
 {
-    flash_decoder_printf("flash_decoder_open()\r\n");
+    flash_decoder_printf("flash_decoder_open(size=0x%x)\r\n", size);
     // Stream must not be open already
     if (state != DECODER_STATE_CLOSED) {
         util_assert(0);
@@ -160,10 +162,24 @@ error_t flash_decoder_open(void)
     current_addr = 0;
     flash_initialized = false;
     initial_addr_set = false;
+    image_size = size;
+    in_place = false;
 
     return ERROR_SUCCESS;
 }
 
+error_t flash_decoder_open_in_place(uint32_t size)
+{
+    error_t status;
+
+    status = flash_decoder_open(size);
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+    in_place = true;
+    return ERROR_SUCCESS;
+}
+
 error_t flash_decoder_write(uint32_t addr, const uint8_t * data, uint32_t size)
 {
     error_t status;
@@ -193,7 +209,11 @@ error_t flash_decoder_write(uint32_t addr, const uint8_t * data, uint32_t size)
         current_addr += size;
 
         // Buffer data until the flash type is known
-        if (sequential) {
+        if (in_place) {
+            flash_type = FLASH_DECODER_TYPE_TARGET;
+            flash_decoder_printf("    In place update, setting flash_type=%i\r\n", flash_type);
+            flash_type_known = true;
+        } else if (sequential) {
             // Copy data into buffer
             copy_size = MIN(size, sizeof(flash_buf) - flash_buf_pos);
             memcpy(&flash_buf[flash_buf_pos], data, copy_size);
@@ -232,6 +252,15 @@ error_t flash_decoder_write(uint32_t addr, const uint8_t * data, uint32_t size)
             }
             flash_decoder_printf("    flash_start_addr=0x%x\r\n", flash_start_addr);
             
+            // Skip the chip erase for images that only cover part of the target.
+            // An in place update still needs the flash it has not written yet.
+            if (in_place) {
+                flash_manager_set_erase(FLASH_ERASE_DIFF);
+            } else if (FLASH_DECODER_TYPE_TARGET == flash_type) {
+                flash_manager_set_erase(flash_manager_erase_for_image(image_size,
+                                        target_device.flash_end - target_device.flash_start));
+            }
+
             // Initialize flash manager
             util_assert(!flash_initialized);
             status = flash_manager_init(flash_intf);
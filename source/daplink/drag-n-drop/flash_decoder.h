@@ -36,7 +36,12 @@ typedef enum {
 flash_decoder_type_t flash_decoder_detect_type(const uint8_t * data, uint32_t size, uint32_t addr, bool addr_valid);
 error_t flash_decoder_get_flash(flash_decoder_type_t type, uint32_t addr, bool addr_valid, uint32_t * start_addr, const flash_intf_t ** flash_intf);
 
-error_t flash_decoder_open(void);
+// image_size is the number of bytes that will be written, 0 if not known
+error_t flash_decoder_open(uint32_t image_size);
+// Like flash_decoder_open for data that is built from the target flash
+// itself.  The image goes to the target and sectors are only erased
+// right before they are written.
+error_t flash_decoder_open_in_place(uint32_t image_size);
 error_t flash_decoder_write(uint32_t addr, const uint8_t * data, uint32_t size);
 error_t flash_decoder_close(void);
 
@@ -18,6 +18,7 @@
 #define FLASH_INTF_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "error.h"
 
 typedef error_t (*flash_intf_init_cb_t)(void);
@@ -27,6 +28,11 @@ typedef error_t (*flash_intf_erase_sector_cb_t)(uint32_t sector);
 typedef error_t (*flash_intf_erase_chip_cb_t)(void);
 typedef uint32_t (*flash_program_page_min_size_cb_t)(uint32_t addr);
 typedef uint32_t (*flash_erase_sector_size_cb_t)(uint32_t addr);
+typedef bool (*flash_intf_compare_cb_t)(uint32_t addr, const uint8_t * buf, uint32_t size);
+typedef uint8_t (*flash_erased_value_cb_t)(uint32_t addr);
+typedef error_t (*flash_intf_read_cb_t)(uint32_t addr, uint8_t * buf, uint32_t size);
+typedef uint32_t (*flash_intf_keep_size_cb_t)(uint32_t addr);
+typedef error_t (*flash_intf_erase_sector_keep_cb_t)(uint32_t sector, uint32_t keep);
 
 typedef struct {
     flash_intf_init_cb_t init;
@@ -36,6 +42,11 @@ typedef struct {
     flash_intf_erase_chip_cb_t erase_chip;
     flash_program_page_min_size_cb_t program_page_min_size;
     flash_erase_sector_size_cb_t erase_sector_size;
+    flash_intf_compare_cb_t compare;        // Optional, true if flash already holds buf
+    flash_erased_value_cb_t erased_value;   // Optional, 0xFF if not set
+    flash_intf_read_cb_t read;              // Optional, reads flash back
+    flash_intf_keep_size_cb_t keep_size;    // Optional, most bytes erase_sector_keep can keep
+    flash_intf_erase_sector_keep_cb_t erase_sector_keep;    // Optional, erases a sector but its first keep bytes
 } flash_intf_t;
 
 // All flash interfaces.  Unsupported interfaces are NULL.
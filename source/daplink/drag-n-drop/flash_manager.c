@@ -21,10 +21,34 @@
 #include "util.h"
 #include "macro.h"
 #include "error.h"
+#include "daplink.h"
+#include "cortex_m.h"
 
 // Set to 1 to enable debugging
 #define DEBUG_FLASH_MANAGER     0
 
+// Images that fill at least this share of the flash are chip erased,
+// smaller ones are erased sector by sector
+#define CHIP_ERASE_MIN_PERCENT  50
+
+// Blocks that were only partly written when the data moved on are
+// kept in RAM in case the rest arrives later.  HDKs short on RAM
+// lower this in daplink_addr.h.
+#ifndef DAPLINK_FLASH_CACHE_BLOCKS
+#define DAPLINK_FLASH_CACHE_BLOCKS  1
+#endif
+
+// Only blocks that can be read back are cached, the bootloader
+// programs through IAP which cannot
+#if defined(DAPLINK_BL)
+#undef DAPLINK_FLASH_CACHE_BLOCKS
+#define DAPLINK_FLASH_CACHE_BLOCKS  0
+#endif
+
+// Address ranges of the blocks written since init.  Data that goes
+// back to one of them is merged with what is already in flash.
+#define WRITTEN_RANGES          8
+
 #if DEBUG_FLASH_MANAGER
     #include "daplink_debug.h"
     #define flash_manager_printf    debug_msg
@@ -38,22 +62,102 @@ typedef enum {
     STATE_ERROR
 } state_t;
 
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    uint32_t written;       // Bytes of data in the block
+    uint8_t data[1024];
+    bool erase_pending;
+} cache_block_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} range_t;
+
 // Target programming expects buffer
 // passed in to be 4 byte aligned
 __attribute__((aligned (4)))
 static uint8_t buf[1024];
 static bool buf_empty;
-static bool current_sector_valid;
+static uint32_t buf_written;
+static bool current_block_valid;
+static bool current_block_erase_pending;
 static uint32_t current_write_block_addr;
 static uint32_t current_write_block_size;
 static uint32_t current_sector_addr;
 static uint32_t current_sector_size;
-static uint32_t last_addr;
+static bool current_sector_erase_pending;
+static bool current_sector_deferred;    // Bigger than buf and not erased yet
+static uint32_t current_sector_matched; // Bytes from its start the flash already holds
+static uint8_t erased_value;
 static const flash_intf_t * intf;
 static state_t state = STATE_CLOSED;
+static flash_erase_t erase_mode = FLASH_ERASE_CHIP;
+static bool locked;
+
+#if DAPLINK_FLASH_CACHE_BLOCKS > 0
+static cache_block_t cache[DAPLINK_FLASH_CACHE_BLOCKS];
+#endif
+static uint32_t cache_count;
+
+static range_t written[WRITTEN_RANGES];
+static uint32_t written_count;
+static uint32_t written_floor;  // Ranges below this were dropped
 
 static bool flash_intf_valid(const flash_intf_t * flash_intf);
 static error_t setup_next_sector(uint32_t addr);
+static error_t enter_block(uint32_t addr);
+static error_t leave_block(void);
+static error_t erase_sector_at(uint32_t addr);
+static error_t deferred_sector_erase(void);
+static error_t deferred_sector_leave(void);
+static error_t flush_block(uint32_t addr, const uint8_t * data, uint32_t size, bool erase_pending);
+static bool buffer_erased(const uint8_t * data, uint32_t size);
+static error_t cache_put(void);
+static bool cache_take(uint32_t addr);
+static error_t cache_flush(uint32_t index);
+static bool written_overlaps(uint32_t addr, uint32_t size, bool * known);
+static void written_add(uint32_t addr, uint32_t size);
+
+bool flash_manager_lock(void)
+{
+    cortex_int_state_t int_state;
+    bool was_locked;
+
+    int_state = cortex_int_get_and_disable();
+    was_locked = locked;
+    locked = true;
+    cortex_int_restore(int_state);
+    return !was_locked;
+}
+
+void flash_manager_unlock(void)
+{
+    util_assert(locked);
+    util_assert(STATE_CLOSED == state);
+    erase_mode = FLASH_ERASE_CHIP;
+    locked = false;
+}
+
+void flash_manager_set_erase(flash_erase_t erase)
+{
+    // Only takes effect on the next init
+    util_assert(STATE_CLOSED == state);
+    erase_mode = erase;
+}
+
+flash_erase_t flash_manager_erase_for_image(uint32_t image_size, uint32_t flash_size)
+{
+    // An unknown size is most likely a small image being iterated on
+    if ((0 == image_size) || (0 == flash_size)) {
+        return FLASH_ERASE_DIFF;
+    }
+    if ((uint64_t)image_size * 100 >= (uint64_t)flash_size * CHIP_ERASE_MIN_PERCENT) {
+        return FLASH_ERASE_CHIP;
+    }
+    return FLASH_ERASE_DIFF;
+}
 
 error_t flash_manager_init(const flash_intf_t * flash_intf)
 {
@@ -75,12 +179,19 @@ error_t flash_manager_init(const flash_intf_t * flash_intf)
     // Initialize variables
     memset(buf, 0xFF, sizeof(buf));
     buf_empty = true;
-    current_sector_valid = false;
+    buf_written = 0;
+    current_block_valid = false;
+    current_block_erase_pending = false;
     current_write_block_addr = 0;
     current_write_block_size = 0;
     current_sector_addr = 0;
     current_sector_size = 0;
-    last_addr = 0;
+    current_sector_erase_pending = false;
+    current_sector_deferred = false;
+    current_sector_matched = 0;
+    cache_count = 0;
+    written_count = 0;
+    written_floor = 0;
     intf = flash_intf;
 
     // Initialize flash
@@ -91,11 +202,13 @@ error_t flash_manager_init(const flash_intf_t * flash_intf)
     }
 
     // Erase flash and unint if there are errors
-    status = intf->erase_chip();
-    flash_manager_printf("    intf->erase_chip ret=%i\r\n", status);
-    if (ERROR_SUCCESS != status) {
-        intf->uninit();
-        return status;
+    if (FLASH_ERASE_CHIP == erase_mode) {
+        status = intf->erase_chip();
+        flash_manager_printf("    intf->erase_chip ret=%i\r\n", status);
+        if (ERROR_SUCCESS != status) {
+            intf->uninit();
+            return status;
+        }
     }
 
     state = STATE_OPEN;
@@ -105,9 +218,8 @@ error_t flash_manager_init(const flash_intf_t * flash_intf)
 
 error_t flash_manager_data(uint32_t addr, const uint8_t * data, uint32_t size)
 {
-    uint32_t size_left;
     uint32_t copy_size;
-        uint32_t pos;
+    uint32_t pos;
     error_t status = ERROR_SUCCESS;
 
     flash_manager_printf("flash_manager_data(addr=0x%x size=0x%x)\r\n", addr, size);
@@ -117,73 +229,79 @@ error_t flash_manager_data(uint32_t addr, const uint8_t * data, uint32_t size)
         return ERROR_INTERNAL;
     }
 
-    // Enforce that addresses are sequential.  Currently flash manager
-    // only supports sequential addresses.  In the future flash manager
-    // could be updated to support this.
-    if (addr < last_addr) {
-        util_assert(0);
-        state = STATE_ERROR;
-        return ERROR_INTERNAL;
-    }
-
-    // Setup the current sector if it is not setup already
-    if (!current_sector_valid) {
-        current_sector_valid = true;
-        status = setup_next_sector(addr);
-        if (ERROR_SUCCESS != status) {
-            state = STATE_ERROR;
-            return status;
-        }
-
-    }
-
-    while (true) {
-        // flush if necessary
-        if (addr >= current_write_block_addr + current_write_block_size) {
-            
-            // Write out current buffer
-            status = intf->program_page(current_write_block_addr, buf, current_write_block_size);
-            flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n", current_write_block_addr, current_write_block_size, status);
-            if (ERROR_SUCCESS != status) {
-                state = STATE_ERROR;
-                return status;
+    while (size > 0) {
+        // Move to the block that holds addr.  Addresses do not have
+        // to be sequential, going back to a block merges the new data
+        // with the data from before.
+        if (!current_block_valid || (addr < current_write_block_addr) ||
+                (addr >= current_write_block_addr + current_write_block_size)) {
+            status = leave_block();
+            if (ERROR_SUCCESS == status) {
+                status = enter_block(addr);
             }
-            // Setup for next page
-            memset(buf, 0xFF, current_write_block_size);
-            buf_empty = true;
-            current_write_block_addr += current_write_block_size;
-        }
-
-        // Check for end
-        if (size <= 0) {
-            break;
-        }
-
-        // Change sector if necessary
-        if (addr >= current_sector_addr + current_sector_size) {
-            status = setup_next_sector(addr);
             if (ERROR_SUCCESS != status) {
                 state = STATE_ERROR;
                 return status;
             }
-
-            //TODO - future improvement - erase sector here
         }
 
         // write buffer
         pos = addr - current_write_block_addr;
-        size_left = current_write_block_size - pos;
-        copy_size = MIN(size, size_left);
+        copy_size = MIN(size, current_write_block_size - pos);
         memcpy(buf + pos, data, copy_size);
-        buf_empty = copy_size == 0;
+        buf_empty = false;
+        buf_written += copy_size;
 
         // Update variables
         addr += copy_size;
         data += copy_size;
         size -= copy_size;
 
+        // Write out the block as soon as the data reaches its end
+        if (addr == current_write_block_addr + current_write_block_size) {
+            status = leave_block();
+            if (ERROR_SUCCESS != status) {
+                state = STATE_ERROR;
+                return status;
+            }
+        }
     }
-    last_addr = addr;
+    return status;
+}
+
+error_t flash_manager_erase(uint32_t addr, uint32_t size)
+{
+    uint32_t end_addr;
+    uint32_t sector_size;
+    error_t status = ERROR_SUCCESS;
+
+    flash_manager_printf("flash_manager_erase(addr=0x%x size=0x%x)\r\n", addr, size);
+
+    if (state != STATE_OPEN) {
+        util_assert(0);
+        return ERROR_INTERNAL;
+    }
+
+    // Erase every sector that overlaps the range.  Sectors
+    // can differ in size so the size is looked up each time.
+    end_addr = addr + size;
+    while (addr < end_addr) {
+        sector_size = intf->erase_sector_size(addr);
+        if (sector_size <= 0) {
+            util_assert(0);
+            state = STATE_ERROR;
+            return ERROR_INTERNAL;
+        }
+        addr = ROUND_DOWN(addr, sector_size);
+        status = intf->erase_sector(addr / sector_size);
+        flash_manager_printf("    intf->erase_sector(sector=%i) ret=%i\r\n", addr / sector_size, status);
+        if (ERROR_SUCCESS != status) {
+            state = STATE_ERROR;
+            return status;
+        }
+        addr += sector_size;
+    }
+
     return status;
 }
 
@@ -200,11 +318,18 @@ error_t flash_manager_uninit(void)
     }
 
 
-    // Write out current page
-    if ((STATE_OPEN == state) && (!buf_empty)) {
-        flash_write_error = intf->program_page(current_write_block_addr, buf, current_write_block_size);
-        flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n",
-                             current_write_block_addr, current_write_block_size, flash_write_error);
+    // Write out the current block and the blocks still in the cache
+    if (STATE_OPEN == state) {
+        if (current_block_valid && !buf_empty) {
+            flash_write_error = flush_block(current_write_block_addr, buf, current_write_block_size,
+                                            current_block_erase_pending);
+        }
+        while ((ERROR_SUCCESS == flash_write_error) && (cache_count > 0)) {
+            flash_write_error = cache_flush(0);
+        }
+        if ((ERROR_SUCCESS == flash_write_error) && current_sector_deferred) {
+            flash_write_error = deferred_sector_leave();
+        }
     }
 
     // Close flash interface (even if there was an error during program_page)
@@ -214,13 +339,21 @@ error_t flash_manager_uninit(void)
     // Reset variables to catch accidental use
     memset(buf, 0xFF, sizeof(buf));
     buf_empty = true;
-    current_sector_valid = false;
+    buf_written = 0;
+    current_block_valid = false;
+    current_block_erase_pending = false;
     current_write_block_addr = 0;
     current_write_block_size = 0;
     current_sector_addr = 0;
     current_sector_size = 0;
-    last_addr = 0;
+    current_sector_erase_pending = false;
+    current_sector_deferred = false;
+    current_sector_matched = 0;
+    cache_count = 0;
+    written_count = 0;
+    written_floor = 0;
     state = STATE_CLOSED;
+    erase_mode = FLASH_ERASE_CHIP;
 
     // Make sure an error from a page write or from an
     // uninit gets propagated
@@ -271,6 +404,16 @@ static error_t setup_next_sector(uint32_t addr)
 {
     uint32_t min_prog_size;
     uint32_t sector_size;
+    bool started;
+    bool known;
+    error_t status;
+
+    if (current_sector_deferred) {
+        status = deferred_sector_leave();
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
 
     min_prog_size = intf->program_page_min_size(addr);
     sector_size = intf->erase_sector_size(addr);
@@ -289,16 +432,348 @@ static error_t setup_next_sector(uint32_t addr)
     // Setup global variables
     current_sector_addr = ROUND_DOWN(addr, sector_size);
     current_sector_size = sector_size;
-    current_write_block_addr = current_sector_addr;
     current_write_block_size = MIN(sector_size, sizeof(buf));
+    erased_value = intf->erased_value ? intf->erased_value(addr) : 0xFF;
+
+    // Erase the sector before the first write to it.  A sector that
+    // was written before is not erased again.  In differential mode
+    // the sector is compared with the flash first and only erased if
+    // it differs.  A sector that fits in buf is compared whole, a
+    // bigger one block by block if the interface can keep the blocks
+    // that matched when it erases.
+    current_sector_erase_pending = false;
+    started = written_overlaps(current_sector_addr, current_sector_size, &known);
+    if (!known) {
+        return ERROR_FD_REWRITE;
+    }
+    if (!started) {
+        if ((FLASH_ERASE_DIFF == erase_mode) && (current_write_block_size == sector_size) && (0 != intf->compare)) {
+            current_sector_erase_pending = true;
+        } else if ((FLASH_ERASE_DIFF == erase_mode) && (0 != intf->compare) &&
+                   (0 != intf->keep_size) && (0 != intf->erase_sector_keep) &&
+                   (intf->keep_size(addr) >= sector_size - current_write_block_size)) {
+            current_sector_deferred = true;
+            current_sector_matched = 0;
+        } else if ((FLASH_ERASE_SECTOR == erase_mode) || (FLASH_ERASE_DIFF == erase_mode)) {
+            status = erase_sector_at(current_sector_addr);
+            if (ERROR_SUCCESS != status) {
+                return status;
+            }
+        }
+    }
 
-    // Clear out buffer in case block size changed
-    memset(buf, 0xFF, current_write_block_size);
-
-    flash_manager_printf("    setup_next_sector(addr=0x%x) sect_addr=0x%x, write_addr=0x%x,\r\n",
-                         addr, current_sector_addr, current_write_block_addr);
+    flash_manager_printf("    setup_next_sector(addr=0x%x) sect_addr=0x%x, started=%i,\r\n",
+                         addr, current_sector_addr, started);
     flash_manager_printf("        actual_write_size=0x%x, sector_size=0x%x, min_write=0x%x\r\n",
                          current_write_block_size, current_sector_size, min_prog_size);
 
     return ERROR_SUCCESS;
 }
+
+// Make the block that holds addr the current block
+static error_t enter_block(uint32_t addr)
+{
+    bool revisit;
+    bool known;
+    error_t status;
+
+    if ((0 == current_sector_size) || (addr < current_sector_addr) ||
+            (addr >= current_sector_addr + current_sector_size)) {
+        status = setup_next_sector(addr);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    current_write_block_addr = current_sector_addr +
+                               ROUND_DOWN(addr - current_sector_addr, current_write_block_size);
+    current_block_valid = true;
+    current_block_erase_pending = false;
+    buf_empty = true;
+    buf_written = 0;
+
+    // The rest of a block that was only partly written
+    if (cache_take(current_write_block_addr)) {
+        return ERROR_SUCCESS;
+    }
+
+    // A block that is new starts out erased
+    revisit = written_overlaps(current_write_block_addr, current_write_block_size, &known);
+    if (!known) {
+        return ERROR_FD_REWRITE;
+    }
+    if (!revisit) {
+        memset(buf, erased_value, current_write_block_size);
+        current_block_erase_pending = current_sector_erase_pending;
+        written_add(current_write_block_addr, current_write_block_size);
+        return ERROR_SUCCESS;
+    }
+
+    // A block that was written before is read back.  Blank flash can
+    // still be programmed, otherwise the block has to be erased and
+    // that is only possible if the block is the whole sector.
+    flash_manager_printf("    revisit block addr=0x%x\r\n", current_write_block_addr);
+    if (0 == intf->read) {
+        return ERROR_FD_REWRITE;
+    }
+    status = intf->read(current_write_block_addr, buf, current_write_block_size);
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+    if (!buffer_erased(buf, current_write_block_size)) {
+        if (current_write_block_size != current_sector_size) {
+            return ERROR_FD_REWRITE;
+        }
+        current_block_erase_pending = true;
+    }
+    return ERROR_SUCCESS;
+}
+
+// Program the current block, or keep it in the cache if only part of it was written
+static error_t leave_block(void)
+{
+    if (!current_block_valid) {
+        return ERROR_SUCCESS;
+    }
+    current_block_valid = false;
+
+    if (buf_empty) {
+        return ERROR_SUCCESS;
+    }
+    // Interfaces that cannot read back are programmed in order
+    if ((buf_written < current_write_block_size) && (0 != intf->read)) {
+        return cache_put();
+    }
+    return flush_block(current_write_block_addr, buf, current_write_block_size, current_block_erase_pending);
+}
+
+static error_t erase_sector_at(uint32_t addr)
+{
+    error_t status;
+    uint32_t sector = addr / intf->erase_sector_size(addr);
+
+    status = intf->erase_sector(sector);
+    flash_manager_printf("    intf->erase_sector(sector=%i) ret=%i\r\n", sector, status);
+    return status;
+}
+
+// Erase a sector whose erase was put off, keeping the blocks that matched
+static error_t deferred_sector_erase(void)
+{
+    uint32_t sector = current_sector_addr / current_sector_size;
+    error_t status;
+
+    current_sector_deferred = false;
+    if (0 == current_sector_matched) {
+        return erase_sector_at(current_sector_addr);
+    }
+    status = intf->erase_sector_keep(sector, current_sector_matched);
+    flash_manager_printf("    intf->erase_sector_keep(sector=%i, keep=0x%x) ret=%i\r\n",
+                         sector, current_sector_matched, status);
+    return status;
+}
+
+// Leave a sector whose erase was put off.  Data that comes back to
+// the blocks past the ones that matched takes them as erased, so the
+// sector is erased after all unless they are blank.  buf is free here.
+static error_t deferred_sector_leave(void)
+{
+    uint32_t addr = current_sector_addr + current_sector_matched;
+    uint32_t end = current_sector_addr + current_sector_size;
+    uint32_t n;
+
+    memset(buf, erased_value, sizeof(buf));
+    for (; addr < end; addr += n) {
+        n = MIN(end - addr, sizeof(buf));
+        if (!intf->compare(addr, buf, n)) {
+            return deferred_sector_erase();
+        }
+    }
+    current_sector_deferred = false;
+    return ERROR_SUCCESS;
+}
+
+static error_t flush_block(uint32_t addr, const uint8_t * data, uint32_t size, bool erase_pending)
+{
+    error_t status;
+
+    // Blocks of a sector bigger than buf are compared in order until
+    // one differs
+    if (current_sector_deferred && (addr >= current_sector_addr) &&
+            (addr < current_sector_addr + current_sector_size)) {
+        if ((addr == current_sector_addr + current_sector_matched) && intf->compare(addr, data, size)) {
+            flash_manager_printf("    block addr=0x%x unchanged\r\n", addr);
+            current_sector_matched += size;
+            return ERROR_SUCCESS;
+        }
+        status = deferred_sector_erase();
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    // The whole sector is in the block, leave it alone if the flash matches
+    if (erase_pending) {
+        if ((0 != intf->compare) && intf->compare(addr, data, size)) {
+            flash_manager_printf("    sector addr=0x%x unchanged\r\n", addr);
+            return ERROR_SUCCESS;
+        }
+        status = erase_sector_at(addr);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    // Padding and image data equal to erased flash need no write
+    if (buffer_erased(data, size)) {
+        flash_manager_printf("    block addr=0x%x erased\r\n", addr);
+        return ERROR_SUCCESS;
+    }
+
+    status = intf->program_page(addr, data, size);
+    flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n",
+                         addr, size, status);
+    return status;
+}
+
+static bool buffer_erased(const uint8_t * data, uint32_t size)
+{
+    const uint32_t * word = (const uint32_t *)data;
+    uint32_t erased_word = erased_value * 0x01010101;
+    uint32_t i;
+
+    // Block sizes are a multiple of the minimum program size
+    for (i = 0; i < size / 4; i++) {
+        if (word[i] != erased_word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Move the current block into the cache.  When the cache is full the
+// block with the highest address is programmed, data that goes back
+// usually goes to the vector table or to the start of a section.
+static error_t cache_put(void)
+{
+#if DAPLINK_FLASH_CACHE_BLOCKS > 0
+    cache_block_t * block;
+    uint32_t highest = 0;
+    uint32_t i;
+    error_t status;
+
+    if (DAPLINK_FLASH_CACHE_BLOCKS == cache_count) {
+        for (i = 1; i < cache_count; i++) {
+            if (cache[i].addr > cache[highest].addr) {
+                highest = i;
+            }
+        }
+        if (current_write_block_addr > cache[highest].addr) {
+            return flush_block(current_write_block_addr, buf, current_write_block_size, current_block_erase_pending);
+        }
+        status = cache_flush(highest);
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    block = &cache[cache_count++];
+    block->addr = current_write_block_addr;
+    block->size = current_write_block_size;
+    block->written = buf_written;
+    block->erase_pending = current_block_erase_pending;
+    memcpy(block->data, buf, current_write_block_size);
+    flash_manager_printf("    cached block addr=0x%x written=0x%x\r\n", block->addr, block->written);
+    return ERROR_SUCCESS;
+#else
+    return flush_block(current_write_block_addr, buf, current_write_block_size, current_block_erase_pending);
+#endif
+}
+
+// Move the block at addr from the cache into buf
+static bool cache_take(uint32_t addr)
+{
+#if DAPLINK_FLASH_CACHE_BLOCKS > 0
+    uint32_t i;
+
+    for (i = 0; i < cache_count; i++) {
+        if (cache[i].addr == addr) {
+            util_assert(cache[i].size == current_write_block_size);
+            memcpy(buf, cache[i].data, cache[i].size);
+            buf_empty = false;
+            buf_written = cache[i].written;
+            current_block_erase_pending = cache[i].erase_pending;
+            cache_count--;
+            memmove(&cache[i], &cache[i + 1], (cache_count - i) * sizeof(cache[0]));
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+// Program a block from the cache and remove it
+static error_t cache_flush(uint32_t index)
+{
+#if DAPLINK_FLASH_CACHE_BLOCKS > 0
+    error_t status;
+
+    util_assert(index < cache_count);
+    status = flush_block(cache[index].addr, cache[index].data, cache[index].size, cache[index].erase_pending);
+    cache_count--;
+    memmove(&cache[index], &cache[index + 1], (cache_count - index) * sizeof(cache[0]));
+    return status;
+#else
+    util_assert(0);
+    return ERROR_INTERNAL;
+#endif
+}
+
+// Check if any block in the range has been written.  known is
+// false if the range reaches below ranges that were dropped.
+static bool written_overlaps(uint32_t addr, uint32_t size, bool * known)
+{
+    uint32_t i;
+
+    for (i = 0; i < written_count; i++) {
+        if ((addr < written[i].end) && (written[i].start < addr + size)) {
+            *known = true;
+            return true;
+        }
+    }
+    *known = addr >= written_floor;
+    return false;
+}
+
+static void written_add(uint32_t addr, uint32_t size)
+{
+    uint32_t lowest = 0;
+    uint32_t i;
+
+    // Extend a range the block is next to, sequential data only ever needs one
+    for (i = 0; i < written_count; i++) {
+        if (written[i].end == addr) {
+            written[i].end += size;
+            return;
+        }
+        if (written[i].start == addr + size) {
+            written[i].start = addr;
+            return;
+        }
+    }
+
+    // Out of ranges, drop the lowest one.  Data that goes back
+    // below it can no longer be programmed.
+    if (WRITTEN_RANGES == written_count) {
+        for (i = 1; i < written_count; i++) {
+            if (written[i].start < written[lowest].start) {
+                lowest = i;
+            }
+        }
+        written_floor = MAX(written_floor, written[lowest].end);
+        written[lowest] = written[--written_count];
+    }
+    written[written_count].start = addr;
+    written[written_count].end = addr + size;
+    written_count++;
+}
@@ -18,12 +18,42 @@
 #define FLASH_MANAGER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "flash_intf.h"
 #include "error.h"
 
+typedef enum {
+    FLASH_ERASE_CHIP,       // Erase the whole chip in flash_manager_init
+    FLASH_ERASE_NONE,       // Leave erasing to flash_manager_erase
+    FLASH_ERASE_SECTOR,     // Erase each sector just before its first write
+    FLASH_ERASE_DIFF        // Like FLASH_ERASE_SECTOR but skip sectors that already match
+} flash_erase_t;
+
+// Take the target flash for one programming session.  Drag-n-drop
+// holds it from stream open to close and the DAP vendor commands from
+// flash open to close, since both run swd_host and target_flash from
+// their own thread.  Returns false if the other one holds it.
+bool flash_manager_lock(void);
+// Give the target flash back.  The erase behavior goes back to
+// FLASH_ERASE_CHIP.
+void flash_manager_unlock(void);
+
+// Erase behavior of the next flash_manager_init.  This is set back to
+// FLASH_ERASE_CHIP by flash_manager_uninit.  Only the holder of the
+// lock may change it.
+void flash_manager_set_erase(flash_erase_t erase);
+
+// Erase behavior for an image of image_size bytes (0 if not known)
+// on a flash of flash_size bytes
+flash_erase_t flash_manager_erase_for_image(uint32_t image_size, uint32_t flash_size);
+
 error_t flash_manager_init(const flash_intf_t * flash_intf);
+// Data may go back to addresses written before if the flash interface
+// can read back.  Fails with ERROR_FD_REWRITE if programmed flash
+// would have to be erased and it is more than one block.
 error_t flash_manager_data(uint32_t addr, const uint8_t * data, uint32_t size);
+error_t flash_manager_erase(uint32_t addr, uint32_t size);
 error_t flash_manager_uninit(void);
 
 
@@ -14,8 +14,8 @@
  * limitations under the License.
  */
 
+
 #include "intelhex.h"
-//#include "stdio.h"
 #include "string.h"
 
 typedef enum hex_record_t hex_record_t;
@@ -40,6 +40,25 @@ union __attribute__((packed)) hex_line_t {
     };
 };
 
+typedef struct hex_output_t hex_output_t;
+struct hex_output_t {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t cnt;
+    hex_segment_t *segments;
+    uint32_t segment_max;
+    uint32_t segment_cnt;
+};
+
+/** Value of each hex character with bit 4 set, 0 for anything else
+ */
+static const uint8_t hex_table[256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+    ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F,
+};
+
 /** Swap 16bit value - let compiler figure out the best way
  *  @param val a variable of size uint16_t to be swapped
  *  @return the swapped value
@@ -49,160 +68,265 @@ static uint16_t swap16(uint16_t a)
     return ((a & 0x00ff) << 8) | ((a & 0xff00) >> 8);
 }
 
-/** Converts a character representation of a hex to real value.
- *   @param c is the hex value in char format
- *   @return the value of the hex
+/** Convert pairs of hex characters into bytes, four characters at a time.
+ *   @param src the hex characters, 2 per byte
+ *   @param dst buffer the bytes go into
+ *   @param count the number of bytes to convert
+ *   @param sum running sum of the converted bytes for the record checksum
+ *   @return 1 if all characters were valid hex otherwise 0
  */
-static uint8_t ctoh(char c)
+static uint8_t decode_bytes(const uint8_t *src, uint8_t *dst, uint32_t count, uint8_t *sum)
 {
-    return (c & 0x10) ? /*0-9*/ c & 0xf : /*A-F, a-f*/ (c & 0xf) + 9;
+    uint8_t a, b, c, d;
+    uint8_t valid = 0x10;
+    uint8_t s = *sum;
+    
+    while (count >= 2) {
+        a = hex_table[src[0]];
+        b = hex_table[src[1]];
+        c = hex_table[src[2]];
+        d = hex_table[src[3]];
+        valid &= a & b & c & d;
+        dst[0] = (uint8_t)(a << 4) | (b & 0xf);
+        dst[1] = (uint8_t)(c << 4) | (d & 0xf);
+        s += dst[0] + dst[1];
+        src += 4;
+        dst += 2;
+        count -= 2;
+    }
+    if (count) {
+        a = hex_table[src[0]];
+        b = hex_table[src[1]];
+        valid &= a & b;
+        dst[0] = (uint8_t)(a << 4) | (b & 0xf);
+        s += dst[0];
+    }
+    *sum = s;
+    return valid != 0;
 }
 
-/** Calculate checksum on a hex record
- *   @param data is the line of hex record
- *   @param size is the length of the data array
- *   @return 1 if the data provided is a valid hex record otherwise 0
+static hex_line_t line = {0};
+// ext_address is the base set by the last extended address record.
+// A segment base is not 64 KB aligned so record offsets are added to it.
+static uint32_t next_address = 0, ext_address = 0;
+static uint8_t line_idx = 0, line_nibble = 0, in_record = 0, line_pending = 0, eof_reached = 0;
+
+/** Make room for decoded data in the output buffer. A new segment is
+ *  started when the data does not follow the previous data.
+ *   @param out the output of the current call
+ *   @param address the address of the data
+ *   @param size the number of bytes of data
+ *   @param dest set to where the data goes in the output buffer
+ *   @return HEX_PARSE_OK or HEX_PARSE_BUFFER_FULL if the output has no room left
  */
-static uint8_t validate_checksum(hex_line_t *record)
+static hexfile_parse_status_t output_reserve(hex_output_t *out, uint32_t address, uint32_t size, uint8_t **dest)
 {
-    uint8_t result = 0, i = 0;
-    for ( ; i < (record->byte_count+5); i++) {
-        result += record->buf[i];
+    uint8_t new_segment = (0 == out->segment_cnt) || (address != next_address);
+
+    if (out->cnt + size > out->size) {
+        return HEX_PARSE_BUFFER_FULL;
+    }
+    if (new_segment && (out->segment_cnt >= out->segment_max)) {
+        return HEX_PARSE_BUFFER_FULL;
+    }
+    if (new_segment) {
+        out->segments[out->segment_cnt].address = address;
+        out->segments[out->segment_cnt].size = 0;
+        out->segment_cnt++;
     }
-    return (result == 0);
+    out->segments[out->segment_cnt - 1].size += size;
+    *dest = out->buf + out->cnt;
+    out->cnt += size;
+    next_address = address + size;
+    return HEX_PARSE_OK;
 }
 
-static hex_line_t line = {0}, shadow_line = {0};
-static uint32_t next_address_to_write = 0;
-static uint8_t low_nibble = 0, idx = 0, record_processed = 0, load_unaligned_record = 0;
+/** Process the complete record held in line
+ *   @param out the output of the current call
+ *   @return A member of hex_parse_status_t that describes the state of decoding
+ */
+static hexfile_parse_status_t process_line(hex_output_t *out)
+{
+    hexfile_parse_status_t status = HEX_PARSE_OK;
+    uint8_t sum = 0, i = 0;
+    uint8_t *dest;
+    
+    for ( ; i < (line.byte_count+5); i++) {
+        sum += line.buf[i];
+    }
+    if (sum != 0) {
+        return HEX_PARSE_CKSUM_FAIL;
+    }
+
+    switch (line.record_type) {
+        case DATA_RECORD:
+            if (line.byte_count > 0) {
+                status = output_reserve(out, ext_address + swap16(line.address), line.byte_count, &dest);
+                if (HEX_PARSE_OK == status) {
+                    memcpy(dest, line.data, line.byte_count);
+                }
+            }
+            break;
+
+        case EOF_RECORD:
+            eof_reached = 1;
+            status = HEX_PARSE_EOF;
+            break;
+
+        case EXT_SEG_ADDR_RECORD:
+            ext_address = ((line.data[0] << 8) | line.data[1]) << 4;
+            break;
+
+        case EXT_LINEAR_ADDR_RECORD:
+            ext_address = (line.data[0] << 24) | (line.data[1] << 16);
+            break;
+
+        default:
+            break;
+    }
+    return status;
+}
 
 void reset_hex_parser(void)
 {
     memset(line.buf, 0, sizeof(hex_line_t));
-    memset(shadow_line.buf, 0, sizeof(hex_line_t));
-    next_address_to_write = 0;
-    low_nibble = 0;
-    idx = 0;
-    record_processed = 0;
-    load_unaligned_record = 0;
+    next_address = 0;
+    ext_address = 0;
+    line_idx = 0;
+    line_nibble = 0;
+    in_record = 0;
+    line_pending = 0;
+    eof_reached = 0;
 }
 
-hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, uint32_t *bin_buf_address, uint32_t *bin_buf_cnt)
+hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, hex_segment_t *segments, const uint32_t segment_max, uint32_t *segment_cnt)
 {
-    uint8_t *end = (uint8_t *)hex_blob + hex_blob_size;
-    hexfile_parse_status_t status = HEX_PARSE_UNINIT;
-    // reset the amount of data that is being return'd
-    *bin_buf_cnt = (uint32_t)0;
-
-    // we had an exit state where the address was unaligned to the previous record and data count.
-    //  Need to pop the last record into the buffer before decoding anthing else since it was 
-    //  already decoded.
-    if (load_unaligned_record) {
-        // need some help...
-        load_unaligned_record = 0;
-        // move from line buffer back to input buffer
-        memcpy((uint8_t *)bin_buf, (uint8_t *)line.data, line.byte_count);
-        bin_buf += line.byte_count;
-        *bin_buf_cnt = (uint32_t)(*bin_buf_cnt) + line.byte_count;
-        // Store next address to write
-        next_address_to_write = ((next_address_to_write & 0xffff0000) | line.address) + line.byte_count;
+    const uint8_t *p = hex_blob;
+    const uint8_t *end = hex_blob + hex_blob_size;
+    hexfile_parse_status_t status = HEX_PARSE_OK;
+    hex_output_t out = {bin_buf, bin_buf_size, 0, segments, segment_max, 0};
+    uint32_t chars;
+    uint8_t *dest;
+    uint8_t sum, value, checksum;
+
+    // Everything after the EOF record is ignored
+    if (eof_reached) {
+        p = end;
+        status = HEX_PARSE_EOF;
+        goto hex_parser_exit;
     }
-    
-    while (hex_blob != end) {
-        switch ((uint8_t)(*hex_blob)) {
-            // we've hit the end of an ascii line
-            // junk we dont care about could also just run the validate_checksum on &line
-            case '\r':
-            case '\n':
-                if (0 == validate_checksum(&line)) {
-                    status = HEX_PARSE_CKSUM_FAIL;
+
+    // The last call decoded a record that did not fit into the output
+    if (line_pending) {
+        line_pending = 0;
+        status = process_line(&out);
+        if (HEX_PARSE_OK != status) {
+            status = (HEX_PARSE_BUFFER_FULL == status) ? HEX_PARSE_FAILURE : status;
+            goto hex_parser_exit;
+        }
+    }
+
+    while (p != end) {
+        // Skip line endings and anything else up to the start of a record
+        if (!in_record) {
+            if (':' == *p) {
+                in_record = 1;
+                line_idx = 0;
+                line_nibble = 0;
+            }
+            p++;
+            continue;
+        }
+
+        // Fast path, the whole record is in the input. Data is decoded
+        // straight into the output buffer.
+        if ((0 == line_idx) && (0 == line_nibble) && (end - p >= 10)) {
+            sum = 0;
+            if (!decode_bytes(p, line.buf, 4, &sum)) {
+                status = HEX_PARSE_FAILURE;
+                goto hex_parser_exit;
+            }
+            chars = 2 * (line.byte_count + 5);
+            if (end - p >= chars) {
+                // Same limit as the slow path, which decodes into line
+                if (line.byte_count > sizeof(line.data)) {
+                    status = HEX_PARSE_LINE_OVERRUN;
                     goto hex_parser_exit;
+                }
+                if ((DATA_RECORD == line.record_type) && (line.byte_count > 0)) {
+                    // Leave the record for the next call if the output is full
+                    status = output_reserve(&out, ext_address + swap16(line.address), line.byte_count, &dest);
+                    if ((HEX_PARSE_BUFFER_FULL == status) && (0 == out.cnt)) {
+                        // The record is bigger than the whole output buffer
+                        status = HEX_PARSE_LINE_OVERRUN;
+                    }
+                    if (HEX_PARSE_OK != status) {
+                        goto hex_parser_exit;
+                    }
+                    if (!decode_bytes(p + 8, dest, line.byte_count, &sum) ||
+                            !decode_bytes(p + chars - 2, &checksum, 1, &sum)) {
+                        status = HEX_PARSE_FAILURE;
+                        goto hex_parser_exit;
+                    }
+                    if (sum != 0) {
+                        status = HEX_PARSE_CKSUM_FAIL;
+                        goto hex_parser_exit;
+                    }
                 } else {
-                     if (!record_processed) {
-                        record_processed = 1;
-                        // address byteswap...
-                        line.address = swap16(line.address);
-                        switch (line.record_type) {
-                            case DATA_RECORD:
-                                // keeping a record of the last hex record
-                                memcpy(shadow_line.buf, line.buf, sizeof(hex_line_t));
-                                
-                                // verify this is a continous block of memory or need to exit and dump
-                                if (((next_address_to_write & 0xffff0000) | line.address) != next_address_to_write) {
-                                    load_unaligned_record = 1;
-                                    status = HEX_PARSE_UNALIGNED;
-                                    goto hex_parser_exit;
-                                }
-                                
-                                // move from line buffer back to input buffer
-                                memcpy(bin_buf, line.data, line.byte_count);
-                                bin_buf += line.byte_count;
-                                *bin_buf_cnt = (uint32_t)(*bin_buf_cnt) + line.byte_count;
-                                // Save next address to write
-                                next_address_to_write = ((next_address_to_write & 0xffff0000) | line.address) + line.byte_count;
-                                break;
-                            
-                            case EOF_RECORD:
-                                // pad rest of the buffer with 0xff
-                                //memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-                                //*bin_buf_cnt = bin_buf_size;
-                                status = HEX_PARSE_EOF;
-                                goto hex_parser_exit;
-                            
-                            case EXT_LINEAR_ADDR_RECORD:
-                                // Could have had data in the buffer so must exit and try to program
-                                //  before updating bin_buf_address with next_address_to_write
-                                //  Good catch Gaute!!
-                                memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-                                // figure the start address for the buffer before returning
-                                *bin_buf_address = next_address_to_write - (uint32_t)(*bin_buf_cnt);
-                                *hex_parse_cnt = (uint32_t)(hex_blob_size - (end - hex_blob));
-
-                                // update the address msb's
-                                next_address_to_write = (next_address_to_write & 0x00000000) | ((line.data[0] << 24) | (line.data[1] << 16));
-
-                                // Need to exit and program if buffer has been filled
-                                status = HEX_PARSE_UNALIGNED;
-                                return status;
-                            
-                            default:
-                                break;
-                        }
+                    if (!decode_bytes(p + 8, line.data, line.byte_count + 1, &sum)) {
+                        status = HEX_PARSE_FAILURE;
+                        goto hex_parser_exit;
                     }
+                    status = process_line(&out);
                 }
-                break;
-        
-            // found start of a new record. reset state variables
-            case ':':
-                memset(line.buf, 0, sizeof(hex_line_t));
-                low_nibble = 0;
-                idx = 0;
-                record_processed = 0;
-                break;
-            
-            // decoding lines
-            default:
-                if (low_nibble) {
-                    line.buf[idx] |= ctoh((uint8_t)(*hex_blob)) & 0xf;
-                    idx++;
-                }
-                else {
-                    if (idx < sizeof(hex_line_t)) {
-                        line.buf[idx] = ctoh((uint8_t)(*hex_blob)) << 4;
-                    }
+                p += chars;
+                in_record = 0;
+                if (HEX_PARSE_OK != status) {
+                    goto hex_parser_exit;
                 }
-                low_nibble = !low_nibble;
-                break;
+                continue;
+            }
+        }
+
+        // Slow path, the record continues past the end of the input.
+        // Decode it into line a character at a time.
+        value = hex_table[*p];
+        if (0 == value) {
+            if (':' == *p) {
+                line_idx = 0;
+                line_nibble = 0;
+                p++;
+                continue;
+            }
+            status = HEX_PARSE_FAILURE;
+            goto hex_parser_exit;
+        }
+        p++;
+        if (!line_nibble) {
+            line_nibble = value;
+            continue;
+        }
+        line.buf[line_idx++] = (uint8_t)(line_nibble << 4) | (value & 0xf);
+        line_nibble = 0;
+        if ((1 == line_idx) && (line.byte_count > sizeof(line.data))) {
+            status = HEX_PARSE_LINE_OVERRUN;
+            goto hex_parser_exit;
+        }
+        if ((line_idx >= 5) && (line_idx == line.byte_count + 5)) {
+            in_record = 0;
+            status = process_line(&out);
+            if (HEX_PARSE_BUFFER_FULL == status) {
+                // Output it at the start of the next call
+                line_pending = 1;
+            }
+            if (HEX_PARSE_OK != status) {
+                goto hex_parser_exit;
+            }
         }
-        hex_blob++;
     }
-    // decoded an entire hex block - verify (cant do this hex_parse_cnt is figured below)
-    //status = (hex_blob_size == (uint32_t)(*hex_parse_cnt)) ? HEX_PARSE_OK : HEX_PARSE_FAILURE;
-    status = HEX_PARSE_OK;
+
 hex_parser_exit:
-    memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-    // figure the start address for the buffer before returning
-    *bin_buf_address = next_address_to_write - (uint32_t)(*bin_buf_cnt);
-    *hex_parse_cnt = (uint32_t)(hex_blob_size - (end - hex_blob));
+    *hex_parse_cnt = (uint32_t)(p - hex_blob);
+    *segment_cnt = out.segment_cnt;
     return status;
 }
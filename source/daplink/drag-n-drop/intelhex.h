@@ -33,30 +33,41 @@
 typedef enum {
     HEX_PARSE_OK = 0,       /*!< The input buffer was complete parsed and converted into the output buffer */
     HEX_PARSE_EOF,          /*!< EOF line found in the hex file */
-    HEX_PARSE_UNALIGNED,    /*!< The address of decoded data isnt consecutive. Need to program what was returned and continue to parse the input buffer */
+    HEX_PARSE_BUFFER_FULL,  /*!< The output buffer or segment list is full. Need to program what was returned and continue to parse the input buffer */
     HEX_PARSE_LINE_OVERRUN, /*!< Error state when the record length is longer than the record structure */
     HEX_PARSE_CKSUM_FAIL,   /*!< Error state when the record checksum doesnt properly compute */
     HEX_PARSE_UNINIT,       /*!< Default state. Return of this type is unrecoverable logic error */
     HEX_PARSE_FAILURE       /*!< Amount of hex data to decode didnt match the parsing logics count of decoded bytes */
 }hexfile_parse_status_t;
 
+/** A run of consecutive addresses decoded into the output buffer
+    @struct hex_segment_t
+ */
+typedef struct {
+    uint32_t address;       /*!< Address of the first byte of the segment */
+    uint32_t size;          /*!< Number of bytes in the segment */
+} hex_segment_t;
+
 /** Prepare any state that is maintained for the start of a file
     @param none
     @return none
  */
 void reset_hex_parser(void);
 
-/** Convert a blob of hex data into its binary equivelant
+/** Convert a blob of hex data into its binary equivelant. Address jumps
+    start a new segment so data for several address ranges can be returned
+    by one call. The segments are packed one after the other in bin_buf.
     @param hex_blob A block of ascii encoded hexfile data
     @param hex_blob_size The amount of valid data in the hex_blob
     @param hex_parse_cnt The amount of hex_blob data from the call that was parsed
     @param bin_buf Buffer the decoded hex file contents goes into
     @param bin_buf_size max size of the buffer
-    @param bin_buf_address The start address for data in the bin_buf as decoded from the hex file
-    @param bin_buf_cnt The amount of data in the bin_buf
+    @param segments The address and size of each run of data in bin_buf
+    @param segment_max max number of segments
+    @param segment_cnt The number of segments returned
     @return A member of hex_parse_status_t that describes the state of decoding
  */
-hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, uint32_t *bin_buf_address, uint32_t *bin_buf_cnt);
+hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, hex_segment_t *segments, const uint32_t segment_max, uint32_t *segment_cnt);
       
 #ifdef __cplusplus
   }
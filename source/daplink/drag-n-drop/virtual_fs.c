@@ -419,6 +419,7 @@ void vfs_read(uint32_t requested_sector, uint8_t *buf, uint32_t num_sectors)
             virtual_media[i].read_cb(sector_offset, buf, sectors_to_write);
             // Update requested sector
             requested_sector += sectors_to_write;
+            buf += sectors_to_write * VFS_SECTOR_SIZE;
             num_sectors -= sectors_to_write;
         }
 
@@ -452,6 +453,7 @@ void vfs_write(uint32_t requested_sector, const uint8_t *buf, uint32_t num_secto
             virtual_media[i].write_cb(sector_offset, buf, sectors_to_read);
             // Update requested sector
             requested_sector += sectors_to_read;
+            buf += sectors_to_read * VFS_SECTOR_SIZE;
             num_sectors -= sectors_to_read;
         }
 
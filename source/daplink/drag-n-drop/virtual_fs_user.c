@@ -77,6 +77,55 @@ static const file_transfer_state_t default_transfer_state = {
     STREAM_TYPE_NONE
 };
 
+// Number of sectors USB MSC transfers to and from the filesystem
+// per callback.  HDKs with RAM to spare raise this in daplink_addr.h.
+#ifndef DAPLINK_MSC_BLOCK_GROUP
+#define DAPLINK_MSC_BLOCK_GROUP 1
+#endif
+
+// Programming task.  USB MSC receives each group of sectors
+// directly into a slot of the programming ring.  The slot is then
+// handed to this task so the USB thread can receive the next group
+// into another slot while the current one is written to flash.
+// The task runs below the main task so USB keeps being serviced
+// while flash is programmed.
+#define PROG_TASK_PRIORITY      (9)
+#define PROG_TASK_STACK         (600)
+#define PROG_RING_SIZE          (2)
+#define PROG_SLOT_SIZE          (DAPLINK_MSC_BLOCK_GROUP * VFS_SECTOR_SIZE)
+
+typedef enum {
+    PROG_OP_OPEN,
+    PROG_OP_WRITE,
+    PROG_OP_CLOSE,
+} prog_op_t;
+
+typedef struct {
+    prog_op_t op;
+    stream_type_t stream;
+    uint32_t sector;
+    uint32_t size;
+    error_t status;
+    uint8_t *data;
+} prog_slot_t;
+
+// Reorder window.  Sectors of the file being programmed that arrive
+// ahead of file_next_sector are held here until the sectors before
+// them have been written.  Sectors further than REORDER_DISTANCE
+// ahead are ignored since they likely belong to something else.
+// HDKs short on RAM lower DAPLINK_MSC_REORDER_SECTORS in
+// daplink_addr.h, without a window sectors must arrive in order.
+#ifndef DAPLINK_MSC_REORDER_SECTORS
+#define DAPLINK_MSC_REORDER_SECTORS 4
+#endif
+#define REORDER_SIZE            (DAPLINK_MSC_REORDER_SECTORS)
+#define REORDER_DISTANCE        (64)
+
+typedef struct {
+    vfs_sector_t sector;
+    uint32_t data[VFS_SECTOR_SIZE / sizeof(uint32_t)];
+} reorder_slot_t;
+
 static const uint8_t mbed_redirect_file[512] =
     "<!doctype html>\r\n"
     "<!-- mbed Platform Website and Authentication Shortcut -->\r\n"
@@ -97,7 +146,6 @@ static const uint32_t connect_delay_ms = 0;
 static const uint32_t disconnect_delay_ms = 500;
 static const uint32_t reconnect_delay_ms = 1100;    // Must be above 1s
 
-static uint32_t usb_buffer[VFS_SECTOR_SIZE/sizeof(uint32_t)];
 static error_t fail_reason = ERROR_SUCCESS;
 static file_transfer_state_t file_transfer_state;
 static char assert_buf[64 + 1];
@@ -112,13 +160,50 @@ static uint32_t vfs_state_remaining_ms;
 static OS_MUT sync_mutex;
 static OS_TID sync_thread = 0;
 
+// Programming ring.  Slots are filled in order by the USB thread
+// and handed back in the same order through prog_done_mbx.  The
+// slot at prog_ring_head doubles as the USB MSC block buffer, while
+// the ring is full USB MSC is held off instead.
+// Stream open and close are queued in order with the writes through
+// prog_ctrl, which does not take up a ring slot.
+static prog_slot_t prog_ring[PROG_RING_SIZE];
+static uint32_t prog_ring_buf[PROG_RING_SIZE][PROG_SLOT_SIZE / sizeof(uint32_t)];
+static prog_slot_t prog_ctrl;
+static bool prog_ctrl_pending;
+static uint32_t prog_ring_head;
+static uint32_t prog_ring_pending;
+static U64 stk_prog_task[PROG_TASK_STACK / sizeof(U64)];
+static OS_TID prog_task_id = 0;
+os_mbx_declare(prog_req_mbx, PROG_RING_SIZE + 1);
+os_mbx_declare(prog_done_mbx, PROG_RING_SIZE + 1);
+
+#if REORDER_SIZE > 0
+static reorder_slot_t reorder_buf[REORDER_SIZE];
+#endif
+
 // Synchronization functions
 static void sync_init(void);
 static void sync_assert_usb_thread(void);
 static void sync_lock(void);
 static void sync_unlock(void);
 
+// Programming task functions
+static void prog_init(void);
+static __task void prog_task(void);
+static bool prog_slot_free(void);
+static void prog_slot_arm(void);
+static void prog_slot_submit(prog_slot_t *slot);
+static bool prog_complete(uint16_t timeout);
+static void prog_ctrl_submit(prog_op_t op, stream_type_t stream, uint32_t size);
+static void prog_write(uint32_t sector, const uint8_t *buf, uint32_t num_of_sectors);
+
+// Reorder window functions
+static void reorder_reset(void);
+static bool reorder_hold(uint32_t sector, const uint8_t *buf);
+static bool reorder_release(void);
+
 static void vfs_user_disconnect_delay(void);
+static void vfs_user_connected_exit(error_t close_status);
 static bool changing_state(void);
 static void build_filesystem(void);
 static void file_change_handler(const vfs_filename_t filename, vfs_file_change_t change, vfs_file_t file, vfs_file_t new_file_data);
@@ -131,7 +216,8 @@ static uint32_t read_file_fail_txt(uint32_t sector_offset, uint8_t* data, uint32
 static uint32_t read_file_assert_txt(uint32_t sector_offset, uint8_t* data, uint32_t num_sectors);
 
 static void transfer_update_file_info(vfs_file_t file, uint32_t start_sector, uint32_t size, stream_type_t stream);
-static void transfer_update_stream_open(stream_type_t stream, uint32_t start_sector, error_t status);
+static void transfer_update_stream_open(stream_type_t stream, uint32_t start_sector);
+static void transfer_update_stream_open_status(error_t status);
 static void transfer_update_stream_data(uint32_t current_sector, uint32_t size, error_t status);
 static void transfer_check_for_completion(void);
 
@@ -188,6 +274,10 @@ void vfs_user_periodic(uint32_t elapsed_ms)
     vfs_user_state_t vfs_state_local;
     vfs_user_state_t vfs_state_local_prev;
     sync_assert_usb_thread();
+
+    // Pick up sectors the programming task has finished
+    prog_slot_arm();
+
     sync_lock();
 
     // Return immediately if the desired state has been reached
@@ -204,6 +294,14 @@ void vfs_user_periodic(uint32_t elapsed_ms)
         return;
     }
 
+    // Wait for the programming task to finish queued work, such
+    // as a stream close, so the filesystem is only rebuilt and a
+    // new stream only opened once the ring is idle
+    if (prog_ring_pending > 0) {
+        sync_unlock();
+        return;
+    }
+
     vfs_user_printf("vfs_user_periodic()\r\n");
 
     // Transistion to new state
@@ -233,25 +331,12 @@ void vfs_user_periodic(uint32_t elapsed_ms)
             break;
         case VFS_USER_STATE_CONNECTED:
             if (file_transfer_state.stream_open) {
-                error_t status;
+                // The rest is done once the programming
+                // task has closed the stream
                 file_transfer_state.stream_open = false;
-                status = stream_close();
-                if (ERROR_SUCCESS == fail_reason) {
-                    fail_reason = status;
-                }
-                vfs_user_printf("    stream_close ret %i\r\n", status);
-            }
-            // Reset if programming was successful  //TODO - move to flash layer
-            if (daplink_is_bootloader() && (ERROR_SUCCESS == fail_reason)) {
-                NVIC_SystemReset();
-            }
-            // If hold in bootloader has been set then reset after usb is disconnected
-            if (daplink_is_interface() && config_ram_get_hold_in_bl()) {
-                NVIC_SystemReset();
-            }
-            // Resume the target if configured to do so //TODO - move to flash layer
-            if (config_get_auto_rst()) {
-                target_set_state(RESET_RUN);
+                prog_ctrl_submit(PROG_OP_CLOSE, STREAM_TYPE_NONE, 0);
+            } else {
+                vfs_user_connected_exit(ERROR_SUCCESS);
             }
             break;
     }
@@ -272,9 +357,18 @@ void vfs_user_periodic(uint32_t elapsed_ms)
     return;
 }
 
+void vfs_user_prog_event(void)
+{
+    sync_assert_usb_thread();
+
+    // Take more data now that a slot is free
+    prog_slot_arm();
+}
+
 void usbd_msc_init(void)
 {
     sync_init();
+    prog_init();
     build_filesystem();
     vfs_state = VFS_USER_STATE_DISCONNECTED;
     vfs_state_next = VFS_USER_STATE_DISCONNECTED;
@@ -319,6 +413,9 @@ void usbd_msc_write_sect(uint32_t sector, uint8_t *buf, uint32_t num_of_sectors)
 
     vfs_write(sector, buf, num_of_sectors);
     file_data_handler(sector, buf, num_of_sectors);
+
+    // Receive the next group into a free slot
+    prog_slot_arm();
 }
 
 static void sync_init(void)
@@ -342,6 +439,249 @@ static void sync_unlock(void)
     os_mut_release(&sync_mutex);
 }
 
+static void prog_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < PROG_RING_SIZE; i++) {
+        prog_ring[i].data = (uint8_t *)prog_ring_buf[i];
+    }
+    prog_ctrl_pending = false;
+    prog_ring_head = 0;
+    prog_ring_pending = 0;
+    if (0 == prog_task_id) {
+        os_mbx_init(&prog_req_mbx, sizeof(prog_req_mbx));
+        os_mbx_init(&prog_done_mbx, sizeof(prog_done_mbx));
+        prog_task_id = os_tsk_create_user(prog_task, PROG_TASK_PRIORITY, (void *)stk_prog_task, PROG_TASK_STACK);
+    }
+}
+
+// Run stream operations queued by the USB thread.  The stream is
+// opened, written and closed from this task only.  Once a write
+// fails the remaining writes are skipped and report the failure.
+static __task void prog_task(void)
+{
+    prog_slot_t *slot;
+    error_t status = ERROR_SUCCESS;
+
+    while (1) {
+        os_mbx_wait(&prog_req_mbx, (void **)&slot, 0xFFFF);
+        switch (slot->op) {
+            case PROG_OP_OPEN:
+                status = stream_open(slot->stream, slot->size);
+                slot->status = status;
+                break;
+            case PROG_OP_WRITE:
+                if ((ERROR_SUCCESS == status) ||
+                        (ERROR_SUCCESS_DONE == status) ||
+                        (ERROR_SUCCESS_DONE_OR_CONTINUE == status)) {
+                    status = stream_write(slot->data, slot->size);
+                }
+                slot->status = status;
+                break;
+            case PROG_OP_CLOSE:
+                slot->status = stream_close();
+                break;
+        }
+        os_mbx_send(&prog_done_mbx, slot, 0xFFFF);
+        main_msc_prog_event();
+    }
+}
+
+// Check if the slot at prog_ring_head is free
+static bool prog_slot_free(void)
+{
+    return (prog_ring_pending - (prog_ctrl_pending ? 1 : 0)) < PROG_RING_SIZE;
+}
+
+// Point USB MSC at the next free slot once held sectors that are next
+// in line have been queued.  While the ring is full the bulk out
+// endpoint is left unread so the host gets NAKed and the USB thread
+// goes on serving the other endpoints.  The programming task raises
+// vfs_user_prog_event when it has finished a slot.
+static void prog_slot_arm(void)
+{
+    while (prog_complete(0));
+    if (!reorder_release() || !prog_slot_free()) {
+        USBD_MSC_BulkOutHold(__TRUE);
+        return;
+    }
+    USBD_MSC_BlockBuf = prog_ring[prog_ring_head].data;
+    USBD_MSC_BulkOutHold(__FALSE);
+}
+
+static void prog_slot_submit(prog_slot_t *slot)
+{
+    if (slot != &prog_ctrl) {
+        util_assert(slot == &prog_ring[prog_ring_head]);
+        prog_ring_head = (prog_ring_head + 1) % PROG_RING_SIZE;
+    } else {
+        util_assert(!prog_ctrl_pending);
+        prog_ctrl_pending = true;
+    }
+    prog_ring_pending++;
+    os_mbx_send(&prog_req_mbx, slot, 0xFFFF);
+}
+
+// Process the oldest finished slot.  Return false if none
+// finished within timeout.
+static bool prog_complete(uint16_t timeout)
+{
+    prog_slot_t *slot;
+
+    if (0 == prog_ring_pending) {
+        return false;
+    }
+    if (OS_R_TMO == os_mbx_wait(&prog_done_mbx, (void **)&slot, timeout)) {
+        return false;
+    }
+    prog_ring_pending--;
+    if (slot == &prog_ctrl) {
+        prog_ctrl_pending = false;
+    }
+
+    switch (slot->op) {
+        case PROG_OP_OPEN:
+            vfs_user_printf("    stream_open ret %i\r\n", slot->status);
+            transfer_update_stream_open_status(slot->status);
+            break;
+        case PROG_OP_WRITE:
+            // Writes finishing after the transfer has ended are dropped
+            if (!file_transfer_state.transfer_finished) {
+                transfer_update_stream_data(slot->sector, slot->size, slot->status);
+            }
+            break;
+        case PROG_OP_CLOSE:
+            vfs_user_printf("    stream_close ret %i\r\n", slot->status);
+            vfs_user_connected_exit(slot->status);
+            break;
+    }
+    return true;
+}
+
+// Queue a stream open or close behind the writes already in the
+// ring.  Its status is picked up by prog_complete.
+static void prog_ctrl_submit(prog_op_t op, stream_type_t stream, uint32_t size)
+{
+    prog_ctrl.op = op;
+    prog_ctrl.stream = stream;
+    prog_ctrl.sector = VFS_INVALID_SECTOR;
+    prog_ctrl.size = size;
+    prog_ctrl.data = 0;
+    prog_slot_submit(&prog_ctrl);
+}
+
+static void reorder_reset(void)
+{
+#if REORDER_SIZE > 0
+    uint32_t i;
+
+    for (i = 0; i < REORDER_SIZE; i++) {
+        reorder_buf[i].sector = VFS_INVALID_SECTOR;
+    }
+#endif
+}
+
+// Hold a sector that arrived early.  Return false if it belongs
+// to the file but the window has no room left for it.
+static bool reorder_hold(uint32_t sector, const uint8_t *buf)
+{
+#if REORDER_SIZE > 0
+    reorder_slot_t *slot = 0;
+    uint32_t i;
+#endif
+    uint32_t file_sectors;
+
+    if (sector - file_transfer_state.file_next_sector > REORDER_DISTANCE) {
+        return true;
+    }
+    file_sectors = (file_transfer_state.file_size + VFS_SECTOR_SIZE - 1) / VFS_SECTOR_SIZE;
+    if ((file_sectors > 0) && (sector >= file_transfer_state.start_sector + file_sectors)) {
+        return true;
+    }
+
+#if REORDER_SIZE > 0
+    // Replace an older copy of the sector or take a free slot
+    for (i = 0; i < REORDER_SIZE; i++) {
+        if (reorder_buf[i].sector == sector) {
+            slot = &reorder_buf[i];
+            break;
+        }
+        if ((0 == slot) && (VFS_INVALID_SECTOR == reorder_buf[i].sector)) {
+            slot = &reorder_buf[i];
+        }
+    }
+
+    if (0 != slot) {
+        slot->sector = sector;
+        memcpy(slot->data, buf, VFS_SECTOR_SIZE);
+        return true;
+    }
+#endif
+
+    // Without a file size the sector may not be part of
+    // this file so drop it rather than fail the transfer
+    return 0 == file_sectors;
+}
+
+// Queue held sectors that are next in line while the ring has room.
+// Return false if one of them is still waiting for a slot.
+static bool reorder_release(void)
+{
+#if REORDER_SIZE > 0
+    bool found;
+    uint32_t i;
+
+    if (!file_transfer_state.stream_open || file_transfer_state.transfer_finished) {
+        return true;
+    }
+
+    do {
+        found = false;
+        for (i = 0; i < REORDER_SIZE; i++) {
+            if (VFS_INVALID_SECTOR == reorder_buf[i].sector) {
+                continue;
+            }
+            if (reorder_buf[i].sector == file_transfer_state.file_next_sector) {
+                if (!prog_slot_free()) {
+                    return false;
+                }
+                prog_write(reorder_buf[i].sector, (uint8_t *)reorder_buf[i].data, 1);
+                file_transfer_state.file_next_sector++;
+                found = true;
+            } else if (reorder_buf[i].sector > file_transfer_state.file_next_sector) {
+                continue;
+            }
+            // Released or overtaken by an in order write
+            reorder_buf[i].sector = VFS_INVALID_SECTOR;
+        }
+    } while (found);
+#endif
+    return true;
+}
+
+// Queue sectors for programming.  Data that USB MSC received
+// into the slot is handed over without a copy.  The caller makes
+// sure the slot is free.
+static void prog_write(uint32_t sector, const uint8_t *buf, uint32_t num_of_sectors)
+{
+    prog_slot_t *slot;
+    uint32_t size;
+
+    size = VFS_SECTOR_SIZE * num_of_sectors;
+    util_assert(size <= PROG_SLOT_SIZE);
+    util_assert(prog_slot_free());
+    slot = &prog_ring[prog_ring_head];
+    slot->op = PROG_OP_WRITE;
+    slot->stream = file_transfer_state.stream;
+    slot->sector = sector;
+    slot->size = size;
+    if (buf != slot->data) {
+        memmove(slot->data, buf, size);
+    }
+    prog_slot_submit(slot);
+}
+
 static void vfs_user_disconnect_delay()
 {
     if (VFS_USER_STATE_CONNECTED == vfs_state) {
@@ -349,6 +689,27 @@ static void vfs_user_disconnect_delay()
     }
 }
 
+// Processing when leaving the connected state, once the stream
+// of the last transfer has been closed
+static void vfs_user_connected_exit(error_t close_status)
+{
+    if (ERROR_SUCCESS == fail_reason) {
+        fail_reason = close_status;
+    }
+    // Reset if programming was successful  //TODO - move to flash layer
+    if (daplink_is_bootloader() && (ERROR_SUCCESS == fail_reason)) {
+        NVIC_SystemReset();
+    }
+    // If hold in bootloader has been set then reset after usb is disconnected
+    if (daplink_is_interface() && config_ram_get_hold_in_bl()) {
+        NVIC_SystemReset();
+    }
+    // Resume the target if configured to do so //TODO - move to flash layer
+    if (config_get_auto_rst()) {
+        target_set_state(RESET_RUN);
+    }
+}
+
 static bool changing_state()
 {
     return vfs_state != vfs_state_next;
@@ -388,9 +749,9 @@ static void build_filesystem()
     // Set mass storage parameters
     USBD_MSC_MemorySize = vfs_get_total_size();
     USBD_MSC_BlockSize  = VFS_SECTOR_SIZE;
-    USBD_MSC_BlockGroup = 1;
+    USBD_MSC_BlockGroup = DAPLINK_MSC_BLOCK_GROUP;
     USBD_MSC_BlockCount = USBD_MSC_MemorySize / USBD_MSC_BlockSize;
-    USBD_MSC_BlockBuf   = (uint8_t *)usb_buffer;
+    USBD_MSC_BlockBuf   = prog_ring[prog_ring_head].data;
 }
 
 // Callback to handle changes to the root directory.  Should be used with vfs_set_file_change_callback
@@ -450,9 +811,9 @@ static void file_change_handler(const vfs_filename_t filename, vfs_file_change_t
 // for detecting the start of a BIN/HEX file and performing programming
 static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_of_sectors)
 {
-    error_t status;
     stream_type_t stream;
-    uint32_t size;
+    uint32_t skip;
+    uint32_t i;
 
     vfs_user_printf("virtual_fs_user file_data_handler(sector=%i, num_of_sectors=%i)\r\n", sector, num_of_sectors);
 
@@ -462,9 +823,11 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
         // look for file types we can program
         stream = stream_start_identify((uint8_t*)buf, VFS_SECTOR_SIZE * num_of_sectors);
         if (STREAM_TYPE_NONE != stream) {
-            status = stream_open(stream);
-            vfs_user_printf("    stream_open stream=%i ret %i\r\n", stream, status);
-            transfer_update_stream_open(stream, sector, status);
+            // Writes are queued behind the open and take its status
+            // if it fails.  The status is picked up by prog_complete.
+            prog_ctrl_submit(PROG_OP_OPEN, stream, file_transfer_state.file_size);
+            vfs_user_printf("    stream_open stream=%i queued\r\n", stream);
+            transfer_update_stream_open(stream, sector);
         }
     }
 
@@ -478,29 +841,46 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
         return;
     }
 
-    // Ignore sectors coming before this file
-    if (sector < file_transfer_state.start_sector) {
-        return;
+    // Skip sectors coming before this file or that were already sent
+    if (sector < file_transfer_state.file_next_sector) {
+        skip = file_transfer_state.file_next_sector - sector;
+        if (skip >= num_of_sectors) {
+            return;
+        }
+        sector += skip;
+        buf += skip * VFS_SECTOR_SIZE;
+        num_of_sectors -= skip;
     }
 
-    // sectors must be in order
-    if (sector != file_transfer_state.file_next_sector) {
+    // Sectors written ahead of time are held until their turn
+    if (sector > file_transfer_state.file_next_sector) {
         vfs_user_printf("    SECTOR OUT OF ORDER\r\n");
+        for (i = 0; i < num_of_sectors; i++) {
+            if (!reorder_hold(sector + i, buf + i * VFS_SECTOR_SIZE)) {
+                file_transfer_state.status = ERROR_OOO_SECTOR;
+                transfer_check_for_completion();
+                return;
+            }
+        }
         return;
     }
 
-    size = VFS_SECTOR_SIZE * num_of_sectors;
-    status = stream_write((uint8_t*)buf, size);
-    vfs_user_printf("    stream_write ret %i\r\n", status);
-    transfer_update_stream_data(sector, size, status);
+    // The status of each sector is picked up once the programming
+    // task has written it.  Held sectors that are next in line
+    // follow before USB MSC takes more data.
+    prog_write(sector, buf, num_of_sectors);
+    file_transfer_state.file_next_sector = sector + num_of_sectors;
 }
 
 // Get the filesize from a filesize callback.
 // The file data must be null terminated for this to work correctly.
 static uint32_t get_file_size(vfs_read_cb_t read_func)
 {
-    // USB buffer must not be in use when get_file_size is called
-    static uint8_t * dummy_buffer = (uint8_t *)usb_buffer;
+    // USB buffer must not be in use when get_file_size is called.
+    // The filesystem is only built while the ring is idle.
+    uint8_t * dummy_buffer = prog_ring[prog_ring_head].data;
+
+    util_assert(0 == prog_ring_pending);
 
     // Determine size of the file by faking a read
     return read_func(0, dummy_buffer, 1);
@@ -681,11 +1061,11 @@ void transfer_update_file_info(vfs_file_t file, uint32_t start_sector, uint32_t
 }
 
 // Update the tranfer state with new information
-static void transfer_update_stream_open(stream_type_t stream, uint32_t start_sector, error_t status)
+static void transfer_update_stream_open(stream_type_t stream, uint32_t start_sector)
 {
     util_assert(!file_transfer_state.stream_open);
-    vfs_user_printf("virtual_fs_user transfer_update_stream_open(stream=%i, start_sector=%i, status=%i)\r\n",
-                    stream, start_sector, status);
+    vfs_user_printf("virtual_fs_user transfer_update_stream_open(stream=%i, start_sector=%i)\r\n",
+                    stream, start_sector);
 
     // Status should still be at it's default of ERROR_SUCCESS
     util_assert(ERROR_SUCCESS == file_transfer_state.status);
@@ -710,16 +1090,31 @@ static void transfer_update_stream_open(stream_type_t stream, uint32_t start_sec
         file_transfer_state.status = ERROR_ERROR_DURING_TRANSFER;
     }
 
-    // Check - were there any errors with the open
-    if (ERROR_SUCCESS == file_transfer_state.status) {
-        file_transfer_state.status = status;
-    }
+    // The stream is treated as open until the programming
+    // task reports otherwise
+    file_transfer_state.file_next_sector = start_sector;
+    file_transfer_state.stream_open = true;
+    reorder_reset();
+    transfer_check_for_completion();
+}
+
+// Update the tranfer state with the result of the stream open
+static void transfer_update_stream_open_status(error_t status)
+{
+    vfs_user_printf("virtual_fs_user transfer_update_stream_open_status(status=%i)\r\n", status);
 
     if (ERROR_SUCCESS == status) {
-        file_transfer_state.file_next_sector = start_sector;
-        file_transfer_state.stream_open = true;
+        return;
+    }
+
+    // The stream never opened so there is nothing to close
+    file_transfer_state.stream_open = false;
+
+    // Check - were there any errors with the open
+    if (!file_transfer_state.transfer_finished) {
+        file_transfer_state.status = status;
+        transfer_check_for_completion();
     }
-    transfer_check_for_completion();
 }
 
 // Update the tranfer state with new information
@@ -727,11 +1122,11 @@ static void transfer_update_stream_data(uint32_t current_sector, uint32_t size,
 {
     util_assert(file_transfer_state.stream_open);
     util_assert(size % VFS_SECTOR_SIZE == 0);
-    util_assert(file_transfer_state.file_next_sector == current_sector);
+    util_assert(current_sector < file_transfer_state.file_next_sector);
+    vfs_user_printf("virtual_fs_user transfer_update_stream_data(sector=%i, status=%i)\r\n", current_sector, status);
 
     file_transfer_state.size_processed += size;
-    file_transfer_state.file_next_sector = current_sector + size / VFS_SECTOR_SIZE;
-    
+
     // Update status
     file_transfer_state.status = status;
     transfer_check_for_completion();
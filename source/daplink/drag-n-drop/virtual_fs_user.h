@@ -53,6 +53,11 @@ void vfs_user_init(bool enabled);
 // Notes: Must only be called from the thread runnning USB
 void vfs_user_periodic(uint32_t elapsed_ms);
 
+// Pick up data the programming task has finished and take more
+// from USB.  Called on main_msc_prog_event.
+// Notes: Must only be called from the thread runnning USB
+void vfs_user_prog_event(void);
+
 
 #ifdef __cplusplus
 }
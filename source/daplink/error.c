@@ -106,6 +106,30 @@ static const char *const error_message[] = {
     // ERROR_BL_UPDT_BAD_CRC
     "The bootloader CRC did not pass.",
 
+    /* Target ownership */
+
+    // ERROR_TARGET_BUSY
+    "The target is being programmed by another session.\r\n",
+
+    /* VFS user errors */
+
+    // ERROR_OOO_SECTOR
+    "File sectors were written too far out of order to be programmed.\r\n",
+
+    /* File stream errors */
+
+    // ERROR_LZ_FORMAT
+    "The compressed file cannot be decoded. It is corrupt or its window is too large.\r\n",
+    // ERROR_PATCH_FORMAT
+    "The patch file cannot be decoded. It is corrupt or was made for a different flash sector or block size.\r\n",
+    // ERROR_PATCH_BASE
+    "The patch does not apply. The target does not hold the image the patch was made from.\r\n",
+
+    /* Flash decoder errors */
+
+    // ERROR_FD_REWRITE
+    "The file goes back to flash that was already programmed and cannot be rewritten. Sort the file by address.\r\n",
+
 };
 COMPILER_ASSERT(ERROR_COUNT == ELEMENTS_IN_ARRAY(error_message));
 
@@ -65,6 +65,20 @@ typedef enum {
     ERROR_IAP_NO_INTERCEPT,
     ERROR_BL_UPDT_BAD_CRC,
 
+    /* Target ownership */
+    ERROR_TARGET_BUSY,
+
+    /* VFS user errors */
+    ERROR_OOO_SECTOR,
+
+    /* File stream errors */
+    ERROR_LZ_FORMAT,
+    ERROR_PATCH_FORMAT,
+    ERROR_PATCH_BASE,
+
+    /* Flash decoder error */
+    ERROR_FD_REWRITE,
+
     // Add new values here
 
     ERROR_COUNT
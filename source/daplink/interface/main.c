@@ -42,6 +42,8 @@
 #define FLAGS_MAIN_POWERDOWN            (1 << 4)
 #define FLAGS_MAIN_DISABLEDEBUG         (1 << 5)
 #define FLAGS_MAIN_PROC_USB             (1 << 9)
+#define FLAGS_MAIN_MSC_PROG             (1 << 10)
+#define FLAGS_MAIN_DAP_BULK             (1 << 11)
 // Used by msd when flashing a new binary
 #define FLAGS_LED_BLINK_30MS            (1 << 6)
 // Timing constants (in 90mS ticks)
@@ -148,6 +150,20 @@ void main_disable_debug_event(void)
     return;
 }
 
+// Programming task finished a block of drag-n-drop data
+void main_msc_prog_event(void)
+{
+    os_evt_set(FLAGS_MAIN_MSC_PROG, main_task_id);
+    return;
+}
+
+// CMSIS-DAP task freed a buffer for a held bulk out packet
+void main_dap_bulk_event(void)
+{
+    os_evt_set(FLAGS_MAIN_DAP_BULK, main_task_id);
+    return;
+}
+
 void USBD_SignalHandler()
 {
     isr_evt_set(FLAGS_MAIN_PROC_USB, main_task_id);
@@ -226,6 +242,7 @@ __task void serial_process()
 }
 
 extern __task void hid_process(void);
+extern void dap_bulk_out_event(void);
 __attribute__((weak)) void prerun_target_config(void){}
 
 __task void main_task(void)
@@ -284,6 +301,8 @@ __task void main_task(void)
                         | FLAGS_MAIN_POWERDOWN          // Power down interface
                         | FLAGS_MAIN_DISABLEDEBUG       // Disable target debug
                         | FLAGS_MAIN_PROC_USB           // process usb events
+                        | FLAGS_MAIN_MSC_PROG           // drag-n-drop data programmed
+                        | FLAGS_MAIN_DAP_BULK           // bulk out buffer freed
                         ,NO_TIMEOUT);
 
         // Find out what event happened
@@ -293,6 +312,14 @@ __task void main_task(void)
             USBD_Handler();
         }
 
+        if (flags & FLAGS_MAIN_MSC_PROG) {
+            vfs_user_prog_event();
+        }
+
+        if (flags & FLAGS_MAIN_DAP_BULK) {
+            dap_bulk_out_event();
+        }
+
         if (flags & FLAGS_MAIN_RESET) {
             target_set_state(RESET_RUN);
         }
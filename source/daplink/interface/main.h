@@ -48,6 +48,8 @@ void main_disable_debug_event(void);
 void main_msc_disconnect_event(void);
 void main_msc_delay_disconnect_event(void);
 void main_force_msc_disconnect_event(void);
+void main_msc_prog_event(void);
+void main_dap_bulk_event(void);
 void main_blink_hid_led(main_led_state_t permanent);
 void main_blink_msc_led(main_led_state_t permanent);
 void main_blink_cdc_led(main_led_state_t permanent);
@@ -70,8 +70,12 @@ typedef struct {
 
 static DAP_STATE dap_state;
 
+// R9 and SP of the last flash algorithm call. The algorithm preserves both,
+// so they are only written again when they change or the cache is invalid.
+static DEBUG_STATE core_state;
+static uint8_t core_state_valid;
+
 static uint8_t swd_read_core_register(uint32_t n, uint32_t *val);
-static uint8_t swd_write_core_register(uint32_t n, uint32_t val);
 
 static void int2array(uint8_t * res, uint32_t data, uint8_t len) {
     uint8_t i = 0;
@@ -99,6 +103,15 @@ uint8_t swd_init(void) {
     return 1;
 }
 
+// Forget the cached SELECT, CSW and core register values. Call this before
+// using the functions below after DAP commands from the host have accessed
+// the target.
+void swd_invalidate_state(void) {
+    dap_state.select = 0xffffffff;
+    dap_state.csw = 0xffffffff;
+    core_state_valid = 0;
+}
+
 // Read debug port register.
 uint8_t swd_read_dp(uint8_t adr, uint32_t *val) {
     uint32_t tmp_in;
@@ -505,41 +518,94 @@ uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size) {
     return 1;
 }
 
-// Execute system call.
-static uint8_t swd_write_debug_state(DEBUG_STATE *state) {
-    uint32_t i, status;
-    
-    if (!swd_write_dp(DP_SELECT, 0)) {
+// Write core registers n[0..count-1], register 16 is xPSR.
+// TAR is set to DHCSR once and the registers are reached through the banked
+// data registers: BD0 = DHCSR, BD1 = DCRSR, BD2 = DCRDR. The DHCSR read that
+// checks S_REGRDY is posted behind the DCRSR write and its result fetched
+// from RDBUFF, so a core that is already done costs no extra round trip.
+static uint8_t swd_write_core_registers(DEBUG_STATE *state, const uint8_t *n, uint32_t count) {
+    uint8_t tmp[4];
+    uint32_t i, val;
+    int j, timeout = 100;
+
+    if (!swd_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32)) {
         return 0;
     }
 
-    // R0, R1, R2, R3
-    for (i = 0; i < 4; i++) {
-        if (!swd_write_core_register(i, state->r[i])) {
-            return 0;
-        }
+    // put DHCSR in TAR register
+    int2array(tmp, DHCSR, 4);
+    if (swd_transfer_retry(SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(AP_TAR), (uint32_t *)tmp) != 0x01) {
+        return 0;
     }
 
-    // R9
-    if (!swd_write_core_register(9, state->r[9])) {
+    if (!swd_write_dp(DP_SELECT, AP_BD0 & APBANKSEL)) {
         return 0;
     }
 
-    // R13, R14, R15
-    for (i=13; i<16; i++) {
-        if (!swd_write_core_register(i, state->r[i])) {
+    for (i = 0; i < count; i++) {
+        val = (n[i] == 16) ? state->xpsr : state->r[n[i]];
+
+        // DCRDR
+        int2array(tmp, val, 4);
+        if (swd_transfer_retry(SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(AP_BD2), (uint32_t *)tmp) != 0x01) {
+            return 0;
+        }
+
+        // DCRSR
+        int2array(tmp, n[i] | REGWnR, 4);
+        if (swd_transfer_retry(SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(AP_BD1), (uint32_t *)tmp) != 0x01) {
+            return 0;
+        }
+
+        // wait for S_REGRDY
+        for (j = 0; j < timeout; j++) {
+            if (swd_transfer_retry(SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(AP_BD0), NULL) != 0x01) {
+                return 0;
+            }
+            if (swd_transfer_retry(SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF), (uint32_t *)tmp) != 0x01) {
+                return 0;
+            }
+            val = (tmp[3] << 24) | (tmp[2] << 16) | (tmp[1] << 8) | tmp[0];
+            if (val & S_REGRDY) {
+                break;
+            }
+        }
+
+        if (j == timeout) {
             return 0;
         }
     }
 
-    // xPSR
-    if (!swd_write_core_register(16, state->xpsr)) {
-        return 0;
+    return 1;
+}
+
+// Execute system call.
+static uint8_t swd_write_debug_state(DEBUG_STATE *state) {
+    uint8_t n[9];
+    uint32_t count, status;
+
+    // R0, R1, R2, R3
+    for (count = 0; count < 4; count++) {
+        n[count] = count;
+    }
+
+    // R9 and R13 are kept from the last call when they did not change
+    if (!core_state_valid || (core_state.r[9] != state->r[9])) {
+        n[count++] = 9;
+    }
+    if (!core_state_valid || (core_state.r[13] != state->r[13])) {
+        n[count++] = 13;
     }
-    
-    if (!swd_write_block(target_device.flash_algo->algo_start, 
-            (uint8_t *)target_device.flash_algo->algo_blob, 
-            target_device.flash_algo->algo_size)){
+
+    // R14, R15 and xPSR
+    n[count++] = 14;
+    n[count++] = 15;
+    n[count++] = 16;
+
+    // Until the call completes the cached registers are unknown
+    core_state_valid = 0;
+
+    if (!swd_write_core_registers(state, n, count)) {
         return 0;
     }
 
@@ -556,6 +622,7 @@ static uint8_t swd_write_debug_state(DEBUG_STATE *state) {
         return 0;
     }
 
+    core_state = *state;
     return 1;
 }
 
@@ -588,30 +655,6 @@ static uint8_t swd_read_core_register(uint32_t n, uint32_t *val) {
     return 1;
 }
 
-static uint8_t swd_write_core_register(uint32_t n, uint32_t val) {
-    int i = 0, timeout = 100;
-    if (!swd_write_word(DCRDR, val))
-        return 0;
-
-    if (!swd_write_word(DCRSR, n | REGWnR)) {
-        return 0;
-    }
-
-    // wait for S_REGRDY
-    for (i = 0; i < timeout; i++) {
-
-        if (!swd_read_word(DHCSR, &val)) {
-            return 0;
-        }
-
-        if (val & S_REGRDY) {
-            return 1;
-        }
-    }
-
-    return 0;
-}
-
 static uint8_t swd_wait_until_halted(void) {
     // Wait for target to stop
     uint32_t val, i, timeout = MAX_TIMEOUT;
@@ -628,9 +671,11 @@ static uint8_t swd_wait_until_halted(void) {
     return 0;
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4) {
+// Start a flash algorithm function on the target without waiting for it.
+// swd_flash_syscall_wait has to be called before the next call is started.
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4) {
     DEBUG_STATE state = {{0},0};
-    // Call flash algorithm function on target and wait for result.
+    // Call flash algorithm function on target.
     state.r[0]     = arg1;                   // R0: Argument 1
     state.r[1]     = arg2;                   // R1: Argument 2
     state.r[2]     = arg3;                   // R2: Argument 3
@@ -647,22 +692,42 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
+    return 1;
+}
+
+// Wait for the function started by swd_flash_syscall_start and check its result.
+uint8_t swd_flash_syscall_wait(void) {
+    uint32_t r0;
+
     if (!swd_wait_until_halted()) {
+        core_state_valid = 0;
         return 0;
     }
 
-    if (!swd_read_core_register(0, &state.r[0])) {
+    if (!swd_read_core_register(0, &r0)) {
+        core_state_valid = 0;
         return 0;
     }
 
+    core_state_valid = 1;
+
     // Flash functions return 0 if successful.
-    if (state.r[0] != 0) {
+    if (r0 != 0) {
         return 0;
     }
 
     return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4) {
+    // Call flash algorithm function on target and wait for result.
+    if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4)) {
+        return 0;
+    }
+
+    return swd_flash_syscall_wait();
+}
+
 // SWD Reset
 static uint8_t swd_reset(void) {
     uint8_t tmp_in[8];
@@ -732,8 +797,7 @@ static uint8_t JTAG2SWD() {
 uint8_t swd_init_debug(void) {
     uint32_t tmp = 0;
     // init dap state with fake values
-    dap_state.select = 0xffffffff;
-    dap_state.csw = 0xffffffff;
+    swd_invalidate_state();
     swd_init();
     // call a target dependant function
     // this function can do several stuff before really
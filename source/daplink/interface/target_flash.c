@@ -24,6 +24,12 @@
 #include "swd_host.h"
 #include "flash_intf.h"
 #include "util.h"
+#include "crc.h"
+#include "debug_cm.h"
+
+#define ALGO_CHECK_SAMPLES  8       // Blob samples read back to check that the algorithm is resident
+#define ALGO_CHECK_SIZE     16      // Bytes per sample
+#define COMPARE_CHUNK       256     // Bytes of flash read back at a time by compare and erase_sector_keep
 
 static error_t target_flash_init(void);
 static error_t target_flash_uninit(void);
@@ -32,6 +38,12 @@ static error_t target_flash_erase_sector(uint32_t sector);
 static error_t target_flash_erase_chip(void);
 static uint32_t target_flash_program_page_min_size(uint32_t addr);
 static uint32_t target_flash_erase_sector_size(uint32_t addr);
+static bool target_flash_compare(uint32_t addr, const uint8_t * buf, uint32_t size);
+static uint8_t target_flash_erased_value(uint32_t addr);
+static error_t target_flash_read(uint32_t addr, uint8_t * buf, uint32_t size);
+static uint32_t target_flash_keep_size(uint32_t addr);
+static error_t target_flash_erase_sector_keep(uint32_t sector, uint32_t keep);
+static error_t target_flash_wait(void);
 
 static const flash_intf_t flash_intf = {
     target_flash_init,
@@ -41,34 +53,149 @@ static const flash_intf_t flash_intf = {
     target_flash_erase_chip,
     target_flash_program_page_min_size,
     target_flash_erase_sector_size,
+    target_flash_compare,
+    target_flash_erased_value,
+    target_flash_read,
+    target_flash_keep_size,
+    target_flash_erase_sector_keep,
 };
     
 const flash_intf_t * const flash_intf_target = &flash_intf;
 
+// A program_page call is left running on the target while the next page
+// is received.  It is checked before anything else runs on the target.
+static uint8_t syscall_pending;
+static uint8_t use_buffer_alt;
+
+// Set while the target is halted for programming.  A read
+// before target_flash_init halts the target itself.
+static uint8_t target_halted;
+
+// Signature of the algorithm that was downloaded last: CRC of the blob
+// and IDCODE of the target it went to
+static uint32_t algo_loaded_crc;
+static uint32_t algo_loaded_idcode;
+static uint8_t algo_loaded_valid;
+
+static uint8_t flash_buf[COMPARE_CHUNK];
+
+// Code part of the blob, the static data behind it is changed by the algorithm
+static uint32_t target_flash_algo_code_size(const program_target_t * flash)
+{
+    uint32_t size = flash->sys_call_s.static_base - flash->algo_start;
+    return MIN(size, flash->algo_size);
+}
+
+// Target RAM above the algorithm, its stack and its buffers
+static uint32_t target_flash_spare_ram(const program_target_t * flash)
+{
+    uint32_t addr = flash->algo_start + flash->algo_size;
+
+    addr = MAX(addr, flash->sys_call_s.stack_pointer);
+    addr = MAX(addr, flash->program_buffer + flash->program_buffer_size);
+    if (0 != flash->program_buffer_alt) {
+        addr = MAX(addr, flash->program_buffer_alt + flash->program_buffer_size);
+    }
+    return ROUND_UP(addr, 4);
+}
+
+// Check that the blob is still in target RAM by reading back samples of its code
+static uint8_t target_flash_algo_resident(const program_target_t * flash, uint32_t crc, uint32_t idcode)
+{
+    static uint8_t sample[ALGO_CHECK_SIZE];
+    uint32_t code_size;
+    uint32_t offset;
+    uint32_t i;
+
+    if (!algo_loaded_valid || (algo_loaded_crc != crc) || (algo_loaded_idcode != idcode)) {
+        return 0;
+    }
+
+    code_size = target_flash_algo_code_size(flash);
+    if (code_size < ALGO_CHECK_SIZE) {
+        return 0;
+    }
+
+    for (i = 0; i < ALGO_CHECK_SAMPLES; i++) {
+        offset = ROUND_DOWN((code_size - ALGO_CHECK_SIZE) * i / (ALGO_CHECK_SAMPLES - 1), 4);
+        if (!swd_read_memory(flash->algo_start + offset, sample, ALGO_CHECK_SIZE)) {
+            return 0;
+        }
+        if (memcmp(sample, (const uint8_t *)flash->algo_blob + offset, ALGO_CHECK_SIZE) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 static error_t target_flash_init()
 {
     const program_target_t * const flash = target_device.flash_algo;
+    uint32_t code_size;
+    uint32_t idcode;
+    uint32_t crc;
+    uint8_t resident;
+
+    // Reset discards a call that was still running
+    syscall_pending = 0;
+    use_buffer_alt = 0;
+    target_halted = 0;
 
     if (0 == target_set_state(RESET_PROGRAM)) {
         return ERROR_RESET;
     }
+    target_halted = 1;
 
-    // Download flash programming algorithm to target and initialise.
-    if (0 == swd_write_memory(flash->algo_start, (uint8_t *)flash->algo_blob, flash->algo_size)) {
-        return ERROR_ALGO_DL;
+    crc = crc32(flash->algo_blob, flash->algo_size);
+    if (0 == swd_read_dp(DP_IDCODE, &idcode)) {
+        return ERROR_RESET;
     }
 
+    resident = target_flash_algo_resident(flash, crc, idcode);
+    algo_loaded_valid = 0;
+
+    if (resident) {
+        // Only the static data has to be restored
+        code_size = target_flash_algo_code_size(flash);
+        if ((code_size < flash->algo_size) &&
+                (0 == swd_write_memory(flash->algo_start + code_size, (uint8_t *)flash->algo_blob + code_size,
+                                       flash->algo_size - code_size))) {
+            return ERROR_ALGO_DL;
+        }
+    } else {
+        // Download flash programming algorithm to target
+        if (0 == swd_write_memory(flash->algo_start, (uint8_t *)flash->algo_blob, flash->algo_size)) {
+            return ERROR_ALGO_DL;
+        }
+    }
+
+    // Initialise, the samples do not prove the whole blob is intact so
+    // a resident algorithm that fails is downloaded again
     if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->init, target_device.flash_start, 0, 0, 0)) {
-        return ERROR_INIT;
+        if (!resident) {
+            return ERROR_INIT;
+        }
+        if (0 == swd_write_memory(flash->algo_start, (uint8_t *)flash->algo_blob, flash->algo_size)) {
+            return ERROR_ALGO_DL;
+        }
+        if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->init, target_device.flash_start, 0, 0, 0)) {
+            return ERROR_INIT;
+        }
     }
 
+    algo_loaded_crc = crc;
+    algo_loaded_idcode = idcode;
+    algo_loaded_valid = 1;
+
     return ERROR_SUCCESS;
 }
 
 static error_t target_flash_uninit(void)
 {
     // when programming is complete the target should be put and held in reset
-    return ERROR_SUCCESS;
+    target_halted = 0;
+    return target_flash_wait();
 }
 
 static error_t target_flash_program_page(uint32_t addr, const uint8_t * buf, uint32_t size)
@@ -82,20 +209,43 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t * buf, uin
 
     while(size > 0) {
         uint32_t write_size = MIN(size, flash->program_buffer_size);
-        
+        uint32_t buffer = flash->program_buffer;
+        error_t status;
+
+        if (0 == flash->program_buffer_alt) {
+            // Only one buffer, it is in use until the running call is done
+            status = target_flash_wait();
+            if (ERROR_SUCCESS != status) {
+                return status;
+            }
+        } else if (use_buffer_alt) {
+            buffer = flash->program_buffer_alt;
+        }
+
         // Write page to buffer
-        if (!swd_write_memory(flash->program_buffer, (uint8_t *)buf, write_size)) {
+        if (!swd_write_memory(buffer, (uint8_t *)buf, write_size)) {
+            target_flash_wait();
             return ERROR_ALGO_DATA_SEQ;
         }
+
+        // Wait for the previous page
+        status = target_flash_wait();
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
         // Run flash programming
-        if (!swd_flash_syscall_exec(&flash->sys_call_s,
-                                    flash->program_page,
-                                    addr,
-                                    flash->program_buffer_size,
-                                    flash->program_buffer,
-                                    0 )) {
+        if (!swd_flash_syscall_start(&flash->sys_call_s,
+                                     flash->program_page,
+                                     addr,
+                                     flash->program_buffer_size,
+                                     buffer,
+                                     0 )) {
             return ERROR_WRITE;
         }
+        syscall_pending = 1;
+        use_buffer_alt = !use_buffer_alt;
+
         addr += write_size;
         buf += write_size;
         size -= write_size;
@@ -107,6 +257,10 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t * buf, uin
 static error_t target_flash_erase_sector(uint32_t sector)
 {
     const program_target_t * const flash = target_device.flash_algo;
+    error_t status = target_flash_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
     if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->erase_sector, sector*target_device.sector_size, 0, 0, 0)) {
         return ERROR_ERASE_SECTOR;
     }
@@ -116,6 +270,10 @@ static error_t target_flash_erase_sector(uint32_t sector)
 static error_t target_flash_erase_chip(void)
 {
     const program_target_t * const flash = target_device.flash_algo;
+    error_t status = target_flash_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
     if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->erase_chip, 0, 0, 0, 0)) {
         return ERROR_ERASE_ALL;
     }
@@ -137,3 +295,116 @@ static uint32_t target_flash_erase_sector_size(uint32_t addr)
         return 0;
     }
 }
+
+static bool target_flash_compare(uint32_t addr, const uint8_t * buf, uint32_t size)
+{
+    uint32_t n;
+
+    // Flash contents are not stable while a page is being programmed
+    if (ERROR_SUCCESS != target_flash_wait()) {
+        return false;
+    }
+
+    // Stop at the first difference, a changed sector usually differs early
+    while (size > 0) {
+        n = MIN(size, sizeof(flash_buf));
+        if (!swd_read_memory(addr, flash_buf, n)) {
+            return false;
+        }
+        if (memcmp(flash_buf, buf, n) != 0) {
+            return false;
+        }
+        addr += n;
+        buf += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+static uint8_t target_flash_erased_value(uint32_t addr)
+{
+    return target_device.erased_zero ? 0x00 : 0xFF;
+}
+
+static error_t target_flash_read(uint32_t addr, uint8_t * buf, uint32_t size)
+{
+    error_t status = target_flash_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
+    if (!target_halted) {
+        if (0 == target_set_state(RESET_PROGRAM)) {
+            return ERROR_RESET;
+        }
+        target_halted = 1;
+    }
+
+    if (!swd_read_memory(addr, buf, size)) {
+        return ERROR_FAILURE;
+    }
+    return ERROR_SUCCESS;
+}
+
+static uint32_t target_flash_keep_size(uint32_t addr)
+{
+    uint32_t spare = target_flash_spare_ram(target_device.flash_algo);
+
+    if ((spare < target_device.ram_start) || (spare >= target_device.ram_end)) {
+        return 0;
+    }
+    return target_device.ram_end - spare;
+}
+
+static error_t target_flash_erase_sector_keep(uint32_t sector, uint32_t keep)
+{
+    const program_target_t * const flash = target_device.flash_algo;
+    uint32_t addr = sector * target_device.sector_size;
+    uint32_t spare = target_flash_spare_ram(flash);
+    uint32_t offset;
+    uint32_t n;
+    error_t status;
+
+    util_assert(keep <= target_flash_keep_size(addr));
+    status = target_flash_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
+    // Park the start of the sector in spare target RAM and
+    // program it back from there once the sector is erased
+    for (offset = 0; offset < keep; offset += n) {
+        n = MIN(keep - offset, sizeof(flash_buf));
+        if (!swd_read_memory(addr + offset, flash_buf, n) ||
+                !swd_write_memory(spare + offset, flash_buf, n)) {
+            return ERROR_ERASE_SECTOR;
+        }
+    }
+
+    status = target_flash_erase_sector(sector);
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
+    for (offset = 0; offset < keep; offset += n) {
+        n = MIN(keep - offset, flash->program_buffer_size);
+        if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->program_page, addr + offset, n, spare + offset, 0)) {
+            return ERROR_WRITE;
+        }
+    }
+    return ERROR_SUCCESS;
+}
+
+static error_t target_flash_wait(void)
+{
+    if (!syscall_pending) {
+        return ERROR_SUCCESS;
+    }
+
+    syscall_pending = 0;
+    if (!swd_flash_syscall_wait()) {
+        return ERROR_WRITE;
+    }
+    return ERROR_SUCCESS;
+}
@@ -52,6 +52,12 @@
 #define DAPLINK_SECTOR_SIZE             0x00000400
 #define DAPLINK_MIN_WRITE_SIZE          0x00000400
 
+/* Drag and drop */
+
+#define DAPLINK_MSC_BLOCK_GROUP         8
+#define DAPLINK_FLASH_CACHE_BLOCKS      2
+#define DAPLINK_MSC_REORDER_SECTORS     4
+
 /* Current build */
 
 #if defined(DAPLINK_BL)
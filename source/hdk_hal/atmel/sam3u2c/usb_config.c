@@ -121,6 +121,8 @@
 //         <o10.0..15> Maximum Input Report Size (in bytes) <1-65535>
 //         <o11.0..15> Maximum Output Report Size (in bytes) <1-65535>
 //         <o12.0..15> Maximum Feature Report Size (in bytes) <1-65535>
+//         <o13.0..15> Maximum High-speed Input Report Size (in bytes) <1-65535>
+//         <o14.0..15> Maximum High-speed Output Report Size (in bytes) <1-65535>
 //       </h>
 //     </e>
 #ifndef HID_ENDPOINT
@@ -129,14 +131,14 @@
   #define HID_ENDPOINT 1
 #endif
 #define USBD_HID_ENABLE             HID_ENDPOINT
-#define USBD_HID_EP_INTIN           3
+#define USBD_HID_EP_INTIN           5
 #define USBD_HID_EP_INTIN_STACK     0
 #define USBD_HID_EP_INTOUT          0//6
 #define USBD_HID_EP_INTOUT_STACK    0
 #define USBD_HID_WMAXPACKETSIZE     64
 #define USBD_HID_BINTERVAL          1
 #define USBD_HID_HS_ENABLE          1
-#define USBD_HID_HS_WMAXPACKETSIZE  64
+#define USBD_HID_HS_WMAXPACKETSIZE  512
 #define USBD_HID_HS_BINTERVAL       1
 #define USBD_HID_STRDESC            L"MBED CMSIS-DAP"
 #define USBD_HID_INREPORT_NUM       1
@@ -144,6 +146,8 @@
 #define USBD_HID_INREPORT_MAX_SZ    64
 #define USBD_HID_OUTREPORT_MAX_SZ   64
 #define USBD_HID_FEATREPORT_MAX_SZ  1
+#define USBD_HID_HS_INREPORT_MAX_SZ  512
+#define USBD_HID_HS_OUTREPORT_MAX_SZ 512
 
 //     <e0.0> Mass Storage Device (MSC)
 //       <i> Enable class support for Mass Storage Device (MSC)
@@ -308,7 +312,7 @@
 #define USBD_CDC_ACM_HS_BINTERVAL       2
 #define USBD_CDC_ACM_EP_BULKIN          6
 #define USBD_CDC_ACM_EP_BULKIN_STACK    0
-#define USBD_CDC_ACM_EP_BULKOUT         5
+#define USBD_CDC_ACM_EP_BULKOUT         3
 #define USBD_CDC_ACM_EP_BULKOUT_STACK   0
 #define USBD_CDC_ACM_WMAXPACKETSIZE1    64
 #define USBD_CDC_ACM_HS_ENABLE1         1
@@ -41,6 +41,7 @@ typedef struct {
     const uint32_t  algo_size;
     const uint32_t *algo_blob;
     const uint32_t  program_buffer_size;
+    const uint32_t  program_buffer_alt;     // second program_buffer to fill while the first one is flashed, 0 if none
 } program_target_t;
 
 #ifdef __cplusplus
@@ -49,10 +49,33 @@ Provides definitions about:
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
 
+/// Indicate that the SWD request and data phases are shifted by the SPI peripheral.
+/// Turnaround, acknowledge and idle cycles are still generated with the I/O pins.
+/// When enabled the functions in \ref DAP_Config_SPI_gr have to be provided.
+#define DAP_SWD_SPI             1               ///< SWD SPI engine: 1 = used, 0 = I/O pins only
+
+/// Clock of the SPI module used for the SWD request and data phases.
+/// This value is used to calculate the SPI baud rate prescalers.
+#define SWD_SPI_CLOCK_HZ        48000000        ///< Bus clock feeding SPI0 in Hz
+
 /// Indicate that JTAG communication mode is available at the Debug Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_JTAG                0               ///< JTAG Mode: 1 = available, 0 = not available.
 
+/// Indicate that SWO trace capture in UART/NRZ mode is available at the Debug Access Port.
+/// SWO is received by UART0 on \ref PIN_SWO_BIT and copied into the trace buffer by DMA.
+/// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
+#define SWO_UART                1               ///< SWO UART:  1 = available, 0 = not available
+
+/// Size of the SWO trace buffer in bytes (must be 2^n).
+/// This information is returned by the command \ref DAP_Info as <b>SWO Trace Buffer Size</b>.
+#define SWO_BUFFER_SIZE         DAPLINK_SWO_BUFFER_SIZE ///< SWO Trace Buffer Size in bytes, see daplink_addr.h
+
+/// Indicate that per-command cycle counts and SWD acknowledge counters are kept.
+/// The counters are read and cleared with the vendor command \ref ID_DAP_Vendor2.
+/// Off by default, the counters take about 550 bytes of the 16 KB RAM.
+#define DAP_STATS               0               ///< Statistics: 1 = counted, 0 = not counted
+
 /// Configure maximum number of JTAG devices on the scan chain connected to the Debug Access Port.
 /// This setting impacts the RAM requirements of the Debug Unit. Valid range is 1 .. 255.
 #define DAP_JTAG_DEV_CNT        0               ///< Maximum number of JTAG devices on scan chain
@@ -316,6 +339,93 @@ static __forceinline void     PIN_nRESET_OUT (uint32_t bit) {
 ///@}
 
 
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_SPI_gr CMSIS-DAP SWD SPI Engine
+\ingroup DAP_ConfigIO_gr
+@{
+
+When \ref DAP_SWD_SPI is enabled the 8-bit packet request and the 32-bit data phase of a SWD
+transfer are shifted by SPI0 instead of toggling the I/O pins for every bit. SWCLK, SWDIO_OUT
+and SWDIO_IN are routed to SPI0 (ALT2) only while a frame is shifted and are switched back
+to GPIO for turnaround, acknowledge and idle cycles. SWDIO_NOE keeps controlling the direction
+of the SWDIO buffer.
+
+SWCLK idles high. Frames that are written use CPHA=1 (CTAR0) so SWDIO changes on the falling
+edge and is sampled by the target on the rising edge. Frames that are read use CPHA=0 (CTAR1)
+so SWDIO is sampled on the falling edge while the target data is stable.
+*/
+
+#define SWD_SPI_CTAR            (SPI_CTAR_FMSZ(8-1) | SPI_CTAR_CPOL_MASK | SPI_CTAR_LSBFE_MASK)
+
+/** SWD SPI engine: Route SWCLK and SWDIO to the SPI module.
+*/
+static __forceinline void     PIN_SWD_SPI_ENABLE  (void) {
+    PIN_SWCLK_PORT->PCR[PIN_SWCLK_BIT]         = PORT_PCR_MUX(2);    /* SPI0_SCK */
+    PIN_SWDIO_OUT_PORT->PCR[PIN_SWDIO_OUT_BIT] = PORT_PCR_MUX(2);    /* SPI0_SOUT */
+    PIN_SWDIO_IN_PORT->PCR[PIN_SWDIO_IN_BIT]   = PORT_PCR_MUX(2)  |  /* SPI0_SIN */
+                                               PORT_PCR_PE_MASK |  /* Pull enable */
+                                               PORT_PCR_PS_MASK;   /* Pull-up */
+}
+
+/** SWD SPI engine: Route SWCLK and SWDIO back to GPIO.
+*/
+static __forceinline void     PIN_SWD_SPI_DISABLE (void) {
+    PIN_SWCLK_PORT->PCR[PIN_SWCLK_BIT]         = PORT_PCR_MUX(1);    /* GPIO */
+    PIN_SWDIO_OUT_PORT->PCR[PIN_SWDIO_OUT_BIT] = PORT_PCR_MUX(1);    /* GPIO */
+    PIN_SWDIO_IN_PORT->PCR[PIN_SWDIO_IN_BIT]   = PORT_PCR_MUX(1)  |  /* GPIO */
+                                               PORT_PCR_PE_MASK |  /* Pull enable */
+                                               PORT_PCR_PS_MASK;   /* Pull-up */
+}
+
+/** SWD SPI engine: Write 8 bits LSB first.
+\param data bits to be written on SWDIO.
+*/
+static __forceinline void     SWD_SPI_OUT (uint32_t data) {
+    SPI0->PUSHR = SPI_PUSHR_CTAS(0) | SPI_PUSHR_TXDATA(data & 0xFF);
+    while (!(SPI0->SR & SPI_SR_RFDF_MASK));
+    (void)SPI0->POPR;
+    SPI0->SR = SPI_SR_RFDF_MASK;
+}
+
+/** SWD SPI engine: Read 8 bits LSB first.
+\return bits read from SWDIO.
+*/
+static __forceinline uint32_t SWD_SPI_IN  (void) {
+    uint32_t data;
+
+    SPI0->PUSHR = SPI_PUSHR_CTAS(1) | SPI_PUSHR_TXDATA(0xFF);
+    while (!(SPI0->SR & SPI_SR_RFDF_MASK));
+    data = SPI0->POPR;
+    SPI0->SR = SPI_SR_RFDF_MASK;
+    return (data & 0xFF);
+}
+
+/** SWD SPI engine: Set the SWCLK frequency.
+Selects the fastest SPI clock that does not exceed the requested frequency.
+\param clock requested SWCLK frequency in Hz.
+\return SWCLK frequency generated by SPI in Hz, 0 when the clock is too slow for the SPI prescalers.
+*/
+static inline uint32_t SWD_SPI_CLOCK (uint32_t clock) {
+    uint32_t br;
+    uint32_t scaler;
+
+    for (br = 0; br < 16; br++) {
+        scaler = (br < 4) ? (2 * (br + 1)) : (1 << br);
+        if ((SWD_SPI_CLOCK_HZ / 2 / scaler) <= clock) {
+            SPI0->MCR    |= SPI_MCR_HALT_MASK;
+            SPI0->CTAR[0] = SWD_SPI_CTAR | SPI_CTAR_CPHA_MASK | SPI_CTAR_BR(br);
+            SPI0->CTAR[1] = SWD_SPI_CTAR | SPI_CTAR_BR(br);
+            SPI0->MCR    &= ~SPI_MCR_HALT_MASK;
+            return (SWD_SPI_CLOCK_HZ / 2 / scaler);
+        }
+    }
+    return (0);
+}
+
+///@}
+
+
 //**************************************************************************************************
 /**
 \defgroup DAP_Config_LEDs_gr CMSIS-DAP Hardware Status LEDs
@@ -413,6 +523,13 @@ static inline void DAP_SETUP (void) {
                                                PORT_PCR_ODE_MASK;  /* Open-drain */
     LED_CONNECTED_GPIO->PCOR  = 1 << LED_CONNECTED_BIT;              /* Turned on */
     LED_CONNECTED_GPIO->PDDR |= 1 << LED_CONNECTED_BIT;              /* Output */
+
+    /* Configure SPI0 for the SWD engine (halted until the clock is set) */
+    SIM->SCGC6 |= SIM_SCGC6_SPI0_MASK;
+    SPI0->MCR   = SPI_MCR_MSTR_MASK    |  /* Master */
+                  SPI_MCR_DIS_TXF_MASK |  /* No TX FIFO */
+                  SPI_MCR_DIS_RXF_MASK |  /* No RX FIFO */
+                  SPI_MCR_HALT_MASK;
 }
 
 /** Reset Target Device with custom specific I/O pin or command sequence.
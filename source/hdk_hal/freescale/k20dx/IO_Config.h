@@ -58,6 +58,11 @@ COMPILER_ASSERT(DAPLINK_HDK_ID == DAPLINK_HDK_ID_K20DX);
 #define PIN_nRESET_BIT          1
 #define PIN_nRESET              (1 << PIN_nRESET_BIT)
 
+// SWO Pin                      PTA1 (UART0_RX)
+#define PIN_SWO_PORT            PORTA
+#define PIN_SWO_BIT             1
+#define PIN_SWO_MUX             2
+
 // Power and fault detection
 
 // PWR_REG_EN PTD2              PTD6
@@ -0,0 +1,146 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "MK20D5.h"
+#include "IO_Config.h"
+#include "swo.h"
+
+extern uint32_t SystemCoreClock;
+
+// SWO is received by UART0 and moved into the trace buffer by DMA channel 0.
+// The major loop covers the whole buffer and reloads itself, the interrupt
+// at the end of each pass only counts the wrap arounds.
+#define SWO_DMA_CH              0
+#define SWO_DMA_SOURCE          2       // DMAMUX source: UART0 Receive
+
+static uint32_t swo_size;
+static volatile uint32_t swo_wraps;
+
+int32_t swo_uart_initialize (void) {
+
+    NVIC_DisableIRQ(DMA0_IRQn);
+
+    SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
+    SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
+    SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    PIN_SWO_PORT->PCR[PIN_SWO_BIT] = PORT_PCR_MUX(PIN_SWO_MUX) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK;
+
+    // 8N1, receiver requests DMA on RDRF
+    UART0->C2 = 0;
+    UART0->C1 = 0;
+    UART0->C5 = UART_C5_RDMAS_MASK;
+
+    DMAMUX->CHCFG[SWO_DMA_CH] = 0;
+    swo_size = 0;
+
+    return 1;
+}
+
+int32_t swo_uart_uninitialize (void) {
+
+    swo_uart_stop();
+    PIN_SWO_PORT->PCR[PIN_SWO_BIT] = PORT_PCR_MUX(1);
+    SIM->SCGC4 &= ~SIM_SCGC4_UART0_MASK;
+
+    return 1;
+}
+
+uint32_t swo_uart_set_baudrate (uint32_t baudrate) {
+    uint32_t div;
+
+    // UART0 runs from the core clock, baudrate = clock / (16 * (SBR + BRFA / 32))
+    div = (2 * SystemCoreClock + (baudrate / 2)) / baudrate;
+    if ((div < 32) || (div >= (0x2000 << 5))) {
+        return 0;
+    }
+
+    UART0->C2 &= ~UART_C2_RE_MASK;
+    UART0->BDH = (div >> 13) & UART_BDH_SBR_MASK;
+    UART0->BDL = (div >> 5) & UART_BDL_SBR_MASK;
+    UART0->C4 = UART_C4_BRFA(div & 0x1F);
+
+    return (2 * SystemCoreClock) / div;
+}
+
+void swo_uart_start (uint8_t *buf, uint32_t size) {
+
+    swo_uart_stop();
+
+    swo_size  = size;
+    swo_wraps = 0;
+
+    DMA0->TCD[SWO_DMA_CH].SADDR         = (uint32_t)&UART0->D;
+    DMA0->TCD[SWO_DMA_CH].SOFF          = 0;
+    DMA0->TCD[SWO_DMA_CH].ATTR          = DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0);
+    DMA0->TCD[SWO_DMA_CH].NBYTES_MLNO   = 1;
+    DMA0->TCD[SWO_DMA_CH].SLAST         = 0;
+    DMA0->TCD[SWO_DMA_CH].DADDR         = (uint32_t)buf;
+    DMA0->TCD[SWO_DMA_CH].DOFF          = 1;
+    DMA0->TCD[SWO_DMA_CH].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(size);
+    DMA0->TCD[SWO_DMA_CH].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(size);
+    DMA0->TCD[SWO_DMA_CH].DLAST_SGA     = -(int32_t)size;
+    DMA0->TCD[SWO_DMA_CH].CSR           = DMA_CSR_INTMAJOR_MASK;
+
+    DMAMUX->CHCFG[SWO_DMA_CH] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(SWO_DMA_SOURCE);
+    DMA0->SERQ = SWO_DMA_CH;
+
+    NVIC_ClearPendingIRQ(DMA0_IRQn);
+    NVIC_EnableIRQ(DMA0_IRQn);
+
+    // Drop anything received before the capture started
+    (void)UART0->S1;
+    (void)UART0->D;
+    UART0->C2 |= UART_C2_RE_MASK | UART_C2_RIE_MASK;
+}
+
+void swo_uart_stop (void) {
+
+    UART0->C2 &= ~(UART_C2_RE_MASK | UART_C2_RIE_MASK);
+    DMA0->CERQ = SWO_DMA_CH;
+    DMAMUX->CHCFG[SWO_DMA_CH] = 0;
+    NVIC_DisableIRQ(DMA0_IRQn);
+    DMA0->CINT = SWO_DMA_CH;
+}
+
+uint32_t swo_uart_count (void) {
+    uint32_t wraps;
+    uint32_t citer;
+    uint32_t pending;
+
+    if (swo_size == 0) {
+        return 0;
+    }
+
+    // A pass that completed before the interrupt was serviced is still pending
+    do {
+        wraps   = swo_wraps;
+        pending = DMA0->INT & (1 << SWO_DMA_CH);
+        citer   = DMA0->TCD[SWO_DMA_CH].CITER_ELINKNO & DMA_CITER_ELINKNO_CITER_MASK;
+    } while ((wraps != swo_wraps) || (pending != (DMA0->INT & (1 << SWO_DMA_CH))));
+
+    if (pending) {
+        wraps++;
+    }
+
+    return (wraps * swo_size) + (swo_size - citer);
+}
+
+void DMA0_IRQHandler (void) {
+
+    DMA0->CINT = SWO_DMA_CH;
+    swo_wraps++;
+}
@@ -323,6 +323,44 @@
 #error "Receive Buffer size must be larger or equal to Bulk Out maximum packet size!"
 #endif
 
+//     <e0.0> Bulk Device (CMSIS-DAP)
+//       <i> Enable vendor specific interface with a Bulk In/Out endpoint pair
+//       <h> Bulk Endpoint Settings
+//         <o1.0..4> Bulk In Endpoint Number                  <1=>   1 <2=>   2 <3=>   3
+//                                            <4=>   4        <5=>   5 <6=>   6 <7=>   7
+//                                            <8=>   8        <9=>   9 <10=> 10 <11=> 11
+//                                            <12=>  12       <13=> 13 <14=> 14 <15=> 15
+//         <o2.0..4> Bulk Out Endpoint Number                 <1=>   1 <2=>   2 <3=>   3
+//                                            <4=>   4        <5=>   5 <6=>   6 <7=>   7
+//                                            <8=>   8        <9=>   9 <10=> 10 <11=> 11
+//                                            <12=>  12       <13=> 13 <14=> 14 <15=> 15
+//         <h> Endpoint Settings
+//           <o3> Maximum Packet Size <1-1024>
+//           <e4> High-speed
+//             <i> If high-speed is enabled set endpoint settings for it
+//             <o5> Maximum Packet Size <1-1024>
+//           </e>
+//         </h>
+//       </h>
+//       <h> Bulk Device Settings
+//         <i> Device specific settings
+//         <s0.126> Bulk Interface String
+//       </h>
+//     </e>
+#ifndef BULK_ENDPOINT
+  #define BULK_ENDPOINT 0
+#else
+  #define BULK_ENDPOINT 1
+#endif
+#define USBD_BULK_ENABLE            BULK_ENDPOINT
+#define USBD_BULK_EP_BULKIN         5
+#define USBD_BULK_EP_BULKOUT        5
+#define USBD_BULK_EP_BULKIN_STACK   0
+#define USBD_BULK_WMAXPACKETSIZE    64
+#define USBD_BULK_HS_ENABLE         0
+#define USBD_BULK_HS_WMAXPACKETSIZE 512
+#define USBD_BULK_STRDESC           L"MBED CMSIS-DAP"
+
 //     <e0> Custom Class Device
 //       <i> Enables USB Custom Class Requests
 //       <i> Class IDs:
@@ -347,7 +385,7 @@
 
 /* USB Device Calculations ---------------------------------------------------*/
 
-#define USBD_IF_NUM                (USBD_HID_ENABLE+USBD_MSC_ENABLE+(USBD_ADC_ENABLE*2)+(USBD_CDC_ACM_ENABLE*2)+USBD_CLS_ENABLE)
+#define USBD_IF_NUM                (USBD_HID_ENABLE+USBD_MSC_ENABLE+(USBD_ADC_ENABLE*2)+(USBD_CDC_ACM_ENABLE*2)+USBD_BULK_ENABLE+USBD_CLS_ENABLE)
 #define USBD_MULTI_IF              (USBD_CDC_ACM_ENABLE*(USBD_HID_ENABLE|USBD_MSC_ENABLE|USBD_ADC_ENABLE))
 #define MAX(x, y)                (((x) < (y)) ? (y) : (x))
 #define USBD_EP_NUM_CALC0           MAX((USBD_HID_ENABLE    *(USBD_HID_EP_INTIN     )), (USBD_HID_ENABLE    *(USBD_HID_EP_INTOUT!=0)*(USBD_HID_EP_INTOUT)))
@@ -357,7 +395,8 @@
 #define USBD_EP_NUM_CALC4           MAX(USBD_EP_NUM_CALC0, USBD_EP_NUM_CALC1)
 #define USBD_EP_NUM_CALC5           MAX(USBD_EP_NUM_CALC2, USBD_EP_NUM_CALC3)
 #define USBD_EP_NUM_CALC6           MAX(USBD_EP_NUM_CALC4, USBD_EP_NUM_CALC5)
-#define USBD_EP_NUM                (USBD_EP_NUM_CALC6)
+#define USBD_EP_NUM_CALC7           MAX((USBD_BULK_ENABLE   *(USBD_BULK_EP_BULKIN   )), (USBD_BULK_ENABLE   *(USBD_BULK_EP_BULKOUT)))
+#define USBD_EP_NUM                 MAX(USBD_EP_NUM_CALC6, USBD_EP_NUM_CALC7)
 
 #if    (USBD_HID_ENABLE)
 #if    (USBD_MSC_ENABLE)
@@ -418,6 +457,18 @@
 #endif
 #endif
 
+#if    (USBD_BULK_ENABLE)
+#if  (((USBD_HID_ENABLE)     && ((USBD_BULK_EP_BULKIN  == USBD_HID_EP_INTIN)      || \
+                                 (USBD_BULK_EP_BULKOUT == USBD_HID_EP_INTOUT)))    || \
+      ((USBD_MSC_ENABLE)     && ((USBD_BULK_EP_BULKIN  == USBD_MSC_EP_BULKIN)     || \
+                                 (USBD_BULK_EP_BULKOUT == USBD_MSC_EP_BULKOUT)))   || \
+      ((USBD_CDC_ACM_ENABLE) && ((USBD_BULK_EP_BULKIN  == USBD_CDC_ACM_EP_INTIN)  || \
+                                 (USBD_BULK_EP_BULKIN  == USBD_CDC_ACM_EP_BULKIN) || \
+                                 (USBD_BULK_EP_BULKOUT == USBD_CDC_ACM_EP_BULKOUT))))
+#error "Bulk Device Interface can not share Endpoints with other Interfaces!"
+#endif
+#endif
+
 #define USBD_ADC_CIF_NUM           (0)
 #define USBD_ADC_SIF1_NUM          (1)
 #define USBD_ADC_SIF2_NUM          (2)
@@ -425,6 +476,7 @@
 #define USBD_CDC_ACM_CIF_NUM       (USBD_ADC_ENABLE*2+USBD_MSC_ENABLE*1+0)
 #define USBD_CDC_ACM_DIF_NUM       (USBD_ADC_ENABLE*2+USBD_MSC_ENABLE*1+1)
 #define USBD_HID_IF_NUM            (USBD_ADC_ENABLE*2+USBD_MSC_ENABLE*1+USBD_CDC_ACM_ENABLE*2+0)
+#define USBD_BULK_IF_NUM           (USBD_ADC_ENABLE*2+USBD_MSC_ENABLE*1+USBD_CDC_ACM_ENABLE*2+USBD_HID_ENABLE*1+0)
 
 #define USBD_ADC_CIF_STR_NUM       (3+USBD_STRDESC_SER_ENABLE+0)
 #define USBD_ADC_SIF1_STR_NUM      (3+USBD_STRDESC_SER_ENABLE+1)
@@ -433,6 +485,7 @@
 #define USBD_CDC_ACM_DIF_STR_NUM   (3+USBD_STRDESC_SER_ENABLE+USBD_ADC_ENABLE*3+1)
 #define USBD_HID_IF_STR_NUM        (3+USBD_STRDESC_SER_ENABLE+USBD_ADC_ENABLE*3+USBD_CDC_ACM_ENABLE*2)
 #define USBD_MSC_IF_STR_NUM        (3+USBD_STRDESC_SER_ENABLE+USBD_ADC_ENABLE*3+USBD_CDC_ACM_ENABLE*2+USBD_HID_ENABLE)
+#define USBD_BULK_IF_STR_NUM       (3+USBD_STRDESC_SER_ENABLE+USBD_ADC_ENABLE*3+USBD_CDC_ACM_ENABLE*2+USBD_HID_ENABLE+USBD_MSC_ENABLE)
 
 #if    (USBD_HID_ENABLE)
 #if    (USBD_HID_HS_ENABLE)
@@ -476,7 +529,16 @@
 #define USBD_CDC_ACM_MAX_PACKET    (0)
 #define USBD_CDC_ACM_MAX_PACKET1   (0)
 #endif
-#define USBD_MAX_PACKET_CALC0     ((USBD_HID_MAX_PACKET   > USBD_HID_MAX_PACKET      ) ? (USBD_HID_MAX_PACKET  ) : (USBD_HID_MAX_PACKET      ))
+#if    (USBD_BULK_ENABLE)
+#if    (USBD_BULK_HS_ENABLE)
+#define USBD_BULK_MAX_PACKET      ((USBD_BULK_HS_WMAXPACKETSIZE > USBD_BULK_WMAXPACKETSIZE) ? USBD_BULK_HS_WMAXPACKETSIZE : USBD_BULK_WMAXPACKETSIZE)
+#else
+#define USBD_BULK_MAX_PACKET       (USBD_BULK_WMAXPACKETSIZE)
+#endif
+#else
+#define USBD_BULK_MAX_PACKET       (0)
+#endif
+#define USBD_MAX_PACKET_CALC0     ((USBD_HID_MAX_PACKET   > USBD_BULK_MAX_PACKET     ) ? (USBD_HID_MAX_PACKET  ) : (USBD_BULK_MAX_PACKET     ))
 #define USBD_MAX_PACKET_CALC1     ((USBD_ADC_MAX_PACKET   > USBD_CDC_ACM_MAX_PACKET  ) ? (USBD_ADC_MAX_PACKET  ) : (USBD_CDC_ACM_MAX_PACKET  ))
 #define USBD_MAX_PACKET_CALC2     ((USBD_MAX_PACKET_CALC0 > USBD_MAX_PACKET_CALC1    ) ? (USBD_MAX_PACKET_CALC0) : (USBD_MAX_PACKET_CALC1    ))
 #define USBD_MAX_PACKET           ((USBD_MAX_PACKET_CALC2 > USBD_CDC_ACM_MAX_PACKET1 ) ? (USBD_MAX_PACKET_CALC2) : (USBD_CDC_ACM_MAX_PACKET1 ))
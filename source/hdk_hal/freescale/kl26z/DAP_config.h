@@ -47,10 +47,24 @@ Provides definitions about:
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
 
+/// Indicate that the SWD request and data phases are shifted by the SPI peripheral.
+/// Turnaround, acknowledge and idle cycles are still generated with the I/O pins.
+/// When enabled the functions in \ref DAP_Config_SPI_gr have to be provided.
+#define DAP_SWD_SPI             1               ///< SWD SPI engine: 1 = used, 0 = I/O pins only
+
+/// Clock of the SPI module used for the SWD request and data phases.
+/// This value is used to calculate the SPI baud rate prescalers.
+#define SWD_SPI_CLOCK_HZ        24000000        ///< Bus clock feeding SPI0 in Hz
+
 /// Indicate that JTAG communication mode is available at the Debug Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_JTAG                0               ///< JTAG Mode: 1 = available, 0 = not available.
 
+/// Indicate that per-command cycle counts and SWD acknowledge counters are kept.
+/// The counters are read and cleared with the vendor command \ref ID_DAP_Vendor2.
+/// Off by default, the counters take about 550 bytes of the 16 KB RAM.
+#define DAP_STATS               0               ///< Statistics: 1 = counted, 0 = not counted
+
 /// Configure maximum number of JTAG devices on the scan chain connected to the Debug Access Port.
 /// This setting impacts the RAM requirements of the Debug Unit. Valid range is 1 .. 255.
 #define DAP_JTAG_DEV_CNT        0               ///< Maximum number of JTAG devices on scan chain
@@ -316,6 +330,93 @@ static __forceinline void     PIN_nRESET_OUT (uint32_t bit) {
 ///@}
 
 
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_SPI_gr CMSIS-DAP SWD SPI Engine
+\ingroup DAP_ConfigIO_gr
+@{
+
+When \ref DAP_SWD_SPI is enabled the 8-bit packet request and the 32-bit data phase of a SWD
+transfer are shifted by SPI0 instead of toggling the I/O pins for every bit. SWCLK and SWDIO
+are routed to SPI0 (ALT2) only while a frame is shifted and are switched back to GPIO for
+turnaround, acknowledge and idle cycles. SPI0 runs in single-wire mode so SWDIO is driven
+only while a frame is written (BIDIROE).
+
+SWCLK idles high. Frames that are written use CPHA=1 so SWDIO changes on the falling edge
+and is sampled by the target on the rising edge. Frames that are read use CPHA=0 so SWDIO
+is sampled on the falling edge while the target data is stable.
+*/
+
+#define SWD_SPI_C1              (SPI_C1_SPE_MASK | SPI_C1_MSTR_MASK | SPI_C1_CPOL_MASK | SPI_C1_LSBFE_MASK)
+#define SWD_SPI_C2              (SPI_C2_SPC0_MASK)
+
+/** SWD SPI engine: Route SWCLK and SWDIO to the SPI module.
+*/
+static __forceinline void     PIN_SWD_SPI_ENABLE  (void) {
+  PIN_SWCLK_PORT->PCR[PIN_SWCLK_BIT] = PORT_PCR_MUX(2);    /* SPI0_SCK */
+  PIN_SWDIO_PORT->PCR[PIN_SWDIO_BIT] = PORT_PCR_MUX(2)  |  /* SPI0_MOSI */
+                                       PORT_PCR_PE_MASK |  /* Pull enable */
+                                       PORT_PCR_PS_MASK;   /* Pull-up */
+}
+
+/** SWD SPI engine: Route SWCLK and SWDIO back to GPIO.
+*/
+static __forceinline void     PIN_SWD_SPI_DISABLE (void) {
+  SPI0->C2 = SWD_SPI_C2;                                   /* Release SWDIO */
+  PIN_SWCLK_PORT->PCR[PIN_SWCLK_BIT] = PORT_PCR_MUX(1);    /* GPIO */
+  PIN_SWDIO_PORT->PCR[PIN_SWDIO_BIT] = PORT_PCR_MUX(1)  |  /* GPIO */
+                                       PORT_PCR_PE_MASK |  /* Pull enable */
+                                       PORT_PCR_PS_MASK;   /* Pull-up */
+}
+
+/** SWD SPI engine: Write 8 bits LSB first.
+\param data bits to be written on SWDIO.
+*/
+static __forceinline void     SWD_SPI_OUT (uint32_t data) {
+  SPI0->C1 = SWD_SPI_C1 | SPI_C1_CPHA_MASK;
+  SPI0->C2 = SWD_SPI_C2 | SPI_C2_BIDIROE_MASK;
+  while (!(SPI0->S & SPI_S_SPTEF_MASK));
+  SPI0->DL = data;
+  while (!(SPI0->S & SPI_S_SPRF_MASK));
+  (void)SPI0->DL;
+}
+
+/** SWD SPI engine: Read 8 bits LSB first.
+\return bits read from SWDIO.
+*/
+static __forceinline uint32_t SWD_SPI_IN  (void) {
+  SPI0->C1 = SWD_SPI_C1;
+  SPI0->C2 = SWD_SPI_C2;
+  while (!(SPI0->S & SPI_S_SPTEF_MASK));
+  SPI0->DL = 0xFF;
+  while (!(SPI0->S & SPI_S_SPRF_MASK));
+  return (SPI0->DL);
+}
+
+/** SWD SPI engine: Set the SWCLK frequency.
+Selects the fastest SPI clock that does not exceed the requested frequency.
+\param clock requested SWCLK frequency in Hz.
+\return SWCLK frequency generated by SPI in Hz, 0 when the clock is too slow for the SPI prescalers.
+*/
+static __inline uint32_t SWD_SPI_CLOCK (uint32_t clock) {
+  uint32_t div;
+  uint32_t spr;
+  uint32_t sppr;
+
+  div = (SWD_SPI_CLOCK_HZ + (clock - 1)) / clock;
+  for (spr = 0; spr <= 8; spr++) {
+    sppr = (div + ((2 << spr) - 1)) / (2 << spr);
+    if (sppr <= 8) {
+      SPI0->BR = SPI_BR_SPPR(sppr - 1) | SPI_BR_SPR(spr);
+      return (SWD_SPI_CLOCK_HZ / (sppr * (2 << spr)));
+    }
+  }
+  return (0);
+}
+
+///@}
+
+
 //**************************************************************************************************
 /**
 \defgroup DAP_Config_LEDs_gr CMSIS-DAP Hardware Status LEDs
@@ -393,6 +494,11 @@ static __inline void DAP_SETUP (void) {
                                          PORT_PCR_PS_MASK;   /* Pull-up */
   PIN_nRESET_GPIO->PSOR  = PIN_nRESET;                       /* High level */
   PIN_nRESET_GPIO->PDDR |= PIN_nRESET;                       /* Output */
+
+  /* Configure SPI0 for the SWD engine */
+  SIM->SCGC4 |= SIM_SCGC4_SPI0_MASK;
+  SPI0->C2 = SWD_SPI_C2;
+  SPI0->C1 = SWD_SPI_C1;
 }
 
 /** Reset Target Device with custom specific I/O pin or command sequence.
@@ -52,6 +52,14 @@
 #define DAPLINK_SECTOR_SIZE             0x00000400
 #define DAPLINK_MIN_WRITE_SIZE          0x00000100
 
+/* Drag and drop */
+
+#define DAPLINK_MSC_BLOCK_GROUP         1
+#define DAPLINK_FLASH_CACHE_BLOCKS      0
+#define DAPLINK_MSC_REORDER_SECTORS     0
+#define DAPLINK_LZ_WINDOW_BITS          8
+#define DAPLINK_PATCH_BLOCK_SIZE        256
+
 /* Current build */
 
 #if defined(DAPLINK_BL)
@@ -54,6 +54,10 @@ Provides definitions about:
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_JTAG                0               ///< JTAG Mode: 1 = available, 0 = not available.
 
+/// Indicate that per-command cycle counts and SWD acknowledge counters are kept.
+/// The counters are read and cleared with the vendor command \ref ID_DAP_Vendor2.
+#define DAP_STATS               1               ///< Statistics: 1 = counted, 0 = not counted
+
 /// Configure maximum number of JTAG devices on the scan chain connected to the Debug Access Port.
 /// This setting impacts the RAM requirements of the Debug Unit. Valid range is 1 .. 255.
 #define DAP_JTAG_DEV_CNT        0               ///< Maximum number of JTAG devices on scan chain
@@ -70,13 +74,20 @@ Provides definitions about:
 /// Maximum Package Size for Command and Response data.
 /// This configuration settings is used to optimized the communication performance with the
 /// debugger and depends on the USB peripheral. Change setting to 1024 for High-Speed USB.
-#define DAP_PACKET_SIZE         64              ///< USB: 64 = Full-Speed, 1024 = High-Speed.
+#define DAP_PACKET_SIZE         1024            ///< USB: 64 = Full-Speed, 1024 = High-Speed.
 
 /// Maximum Package Buffers for Command and Response data.
 /// This configuration settings is used to optimized the communication performance with the
 /// debugger and depends on the USB peripheral. For devices with limited RAM or USB buffer the
 /// setting can be reduced (valid range is 1 .. 255). Change setting to 4 for High-Speed USB.
-#define DAP_PACKET_COUNT        1              ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
+#define DAP_PACKET_COUNT        4               ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
+
+/// Package Size and Buffers used when enumerated on a Full-Speed port.
+/// DAP_PACKET_SIZE and DAP_PACKET_COUNT apply at High-Speed; the packet size and count
+/// reported by \ref DAP_Info follow the speed the device enumerated at. The Full-Speed
+/// buffers share the memory reserved for the High-Speed buffers.
+#define DAP_PACKET_SIZE_FS      64              ///< Full-Speed Package Size.
+#define DAP_PACKET_COUNT_FS     8               ///< Full-Speed Package Buffers.
 
 
 /// Debug Unit is connected to fixed Target Device.
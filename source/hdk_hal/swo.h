@@ -0,0 +1,42 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SWO_H
+#define SWO_H
+
+#include "stdint.h"
+
+/*-----------------------------------------------------------------------------
+ * FUNCTION PROTOTYPES
+ *----------------------------------------------------------------------------*/
+
+/* SWO UART capture driver function prototypes
+ *
+ * swo_uart_set_baudrate returns the baudrate actually configured, 0 if the
+ * requested baudrate cannot be generated.
+ *
+ * swo_uart_start receives into buf (size must be 2^n) until swo_uart_stop is
+ * called, wrapping around at the end of buf without waiting for the reader.
+ * swo_uart_count returns the number of bytes received since start, the byte
+ * with count n is stored at buf[n & (size - 1)].
+ */
+extern int32_t  swo_uart_initialize              (void);
+extern int32_t  swo_uart_uninitialize            (void);
+extern uint32_t swo_uart_set_baudrate            (uint32_t baudrate);
+extern void     swo_uart_start                   (uint8_t *buf, uint32_t size);
+extern void     swo_uart_stop                    (void);
+extern uint32_t swo_uart_count                   (void);
+
+#endif /* SWO_H */
@@ -78,5 +78,6 @@ static const program_target_t flash = {
     0x20000000, // algo_start, start of RAM
     sizeof(K22F_FLM), // algo_size, size of array above
     K22F_FLM,  // image, flash algo instruction array
-    512        // ram_to_flash_bytes_to_be_written
+    512,       // ram_to_flash_bytes_to_be_written
+    0x20001200  // program_buffer_alt, filled while program_buffer is written to flash
 };
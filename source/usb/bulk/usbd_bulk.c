@@ -0,0 +1,150 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "RTL.h"
+#include "rl_usb.h"
+#include "usb_for_lib.h"
+
+
+/* Dummy Weak Functions that need to be provided by user */
+__weak void  usbd_bulk_init        (void)                                        {};
+__weak void  usbd_bulk_data_out    (void)                                        {};
+__weak void  usbd_bulk_data_in     (void)                                        {};
+
+
+/*
+ *  USB Device Bulk Read Data
+ *   Reads the packet waiting on the Bulk Out Endpoint. Until it is read the
+ *   endpoint NAKs further packets, so the user can hold off the host by
+ *   deferring this call from usbd_bulk_data_out.
+ *    Parameters:      buf:  Buffer of at least maximum packet size
+ *    Return Value:    Number of bytes read
+ */
+
+int32_t USBD_BULK_DataRead (uint8_t *buf) {
+  return (USBD_ReadEP(usbd_bulk_ep_bulkout, buf));
+}
+
+
+/*
+ *  USB Device Bulk Send Data
+ *   Starts a transfer on the Bulk In Endpoint. The user is notified through
+ *   usbd_bulk_data_in once the host has taken the packet.
+ *    Parameters:      buf:  Buffer containing data to be sent
+ *                     len:  Number of bytes, at most maximum packet size
+ *    Return Value:    Number of bytes queued for sending
+ */
+
+int32_t USBD_BULK_DataSend (const uint8_t *buf, int32_t len) {
+
+  if (!USBD_Configuration)
+    return (0);
+  if (len > usbd_bulk_maxpacketsize[USBD_HighSpeed])
+    len = usbd_bulk_maxpacketsize[USBD_HighSpeed];
+
+  return (USBD_WriteEP(usbd_bulk_ep_bulkin | 0x80, (U8 *)buf, len));
+}
+
+
+/*
+ *  USB Device Bulk In Endpoint Event Callback
+ *    Parameters:      event: not used (just for compatibility)
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULKIN_Event (U32 event) {
+  usbd_bulk_data_in();
+}
+
+
+/*
+ *  USB Device Bulk Out Endpoint Event Callback
+ *    Parameters:      event: not used (just for compatibility)
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULKOUT_Event (U32 event) {
+  usbd_bulk_data_out();
+}
+
+
+/*
+ *  USB Device Bulk In/Out Endpoint Event Callback
+ *    Parameters:      event: USB Device Event
+ *                       USBD_EVT_OUT: Output Event
+ *                       USBD_EVT_IN:  Input Event
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULK_Event (U32 event) {
+  if (event & USBD_EVT_OUT) {
+    USBD_BULK_EP_BULKOUT_Event (0);
+  }
+  if (event & USBD_EVT_IN) {
+    USBD_BULK_EP_BULKIN_Event (0);
+  }
+}
+
+
+#ifdef __RTX                            /* RTX tasks for handling events */
+
+/*
+ *  USB Device Bulk In Endpoint Event Handler Task
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+__task void USBD_RTX_BULK_EP_BULKIN_Event (void) {
+
+  for (;;) {
+    usbd_os_evt_wait_or (0xFFFF, 0xFFFF);
+    if (usbd_os_evt_get() & USBD_EVT_IN) {
+      USBD_BULK_EP_BULKIN_Event (0);
+    }
+  }
+}
+
+
+/*
+ *  USB Device Bulk Out Endpoint Event Handler Task
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+__task void USBD_RTX_BULK_EP_BULKOUT_Event (void) {
+
+  for (;;) {
+    usbd_os_evt_wait_or (0xFFFF, 0xFFFF);
+    if (usbd_os_evt_get() & USBD_EVT_OUT) {
+      USBD_BULK_EP_BULKOUT_Event (0);
+    }
+  }
+}
+
+
+/*
+ *  USB Device Bulk In/Out Endpoint Event Handler Task
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+__task void USBD_RTX_BULK_EP_BULK_Event (void) {
+
+  for (;;) {
+    usbd_os_evt_wait_or (0xFFFF, 0xFFFF);
+    USBD_BULK_EP_BULK_Event (usbd_os_evt_get());
+  }
+}
+#endif
@@ -46,8 +46,16 @@ __weak BOOL USBD_ReqGetDescriptor_HID (U8 **pD, U32 *len) {
       if (USBD_SetupPacket.wIndexL != usbd_hid_if_num) {
         return (__FALSE);  /* Only Single HID Interface is supported */
       }
-      USBD_EP0Data.pData = (U8 *)USBD_HID_ReportDescriptor;
-      *len = USBD_HID_ReportDescriptorSize;
+      if ((!usbd_hs_enable) && (USBD_HighSpeed == __TRUE)) {
+        return (__FALSE);  /* High speed request but high-speed not enabled */
+      }
+      if (USBD_HighSpeed == __FALSE) {
+        USBD_EP0Data.pData = (U8 *)USBD_HID_ReportDescriptor;
+        *len = USBD_HID_ReportDescriptorSize;
+      } else {
+        USBD_EP0Data.pData = (U8 *)USBD_HID_ReportDescriptor_HS;
+        *len = USBD_HID_ReportDescriptorSize_HS;
+      }
       break;
     case HID_PHYSICAL_DESCRIPTOR_TYPE:
       return (__FALSE);    /* HID Physical Descriptor is not supported */
@@ -27,6 +27,7 @@ U8          *ptrDataOut;
 volatile U16 DataOutToSendLen;
 U16          DataOutSentLen;
 BOOL         DataOutEndWithShortPacket;
+BOOL         DataOutInEvent;
 
 U8          *ptrDataIn;
 U16          DataInReceLen;
@@ -176,8 +177,12 @@ void USBD_HID_EP_INTIN_Event (U32 event) {
       !DataOutEndWithShortPacket) {     /* If all sent and short packet also  */
     ptrDataOut          = NULL;
     DataOutSentLen      = 0;
-    DataOutToSendLen    = usbd_hid_get_report (HID_REPORT_INPUT, USBD_HID_InReport[0], &USBD_HID_InReport[1], USBD_HID_REQ_EP_INT);
-    if (DataOutToSendLen) {             /* If new send should be started      */
+    DataOutToSendLen    = 0;
+    DataOutInEvent      = __TRUE;       /* Report may be sent from callback   */
+    bytes_to_send       = usbd_hid_get_report (HID_REPORT_INPUT, USBD_HID_InReport[0], &USBD_HID_InReport[1], USBD_HID_REQ_EP_INT);
+    DataOutInEvent      = __FALSE;
+    if (bytes_to_send) {                /* If new send should be started      */
+      DataOutToSendLen  = bytes_to_send;
       ptrDataOut        = USBD_HID_InReport;
       if (usbd_hid_inreport_num <= 1)   /* If only in 1 report skip ReportID  */
         ptrDataOut++;
@@ -228,7 +233,7 @@ void USBD_HID_EP_INTIN_Event (U32 event) {
     USBD_WriteEP(usbd_hid_ep_intin | 0x80, ptrDataOut, bytes_to_send);
     ptrDataOut     += bytes_to_send;
     DataOutSentLen += bytes_to_send;
-    if ((DataOutSentLen < usbd_hid_inreport_max_sz) &&
+    if ((DataOutSentLen < usbd_hid_inreport_max_sz[USBD_HighSpeed]) &&
         (bytes_to_send == usbd_hid_maxpacketsize[USBD_HighSpeed])) {
                                         /* If short packet should be sent also*/
       DataOutEndWithShortPacket = __TRUE;
@@ -256,7 +261,7 @@ void USBD_HID_EP_INTOUT_Event (U32 event) {
   ptrDataIn      += bytes_rece;
   DataInReceLen  += bytes_rece;
   if (!bytes_rece ||
-      (DataInReceLen >= usbd_hid_outreport_max_sz) ||
+      (DataInReceLen >= usbd_hid_outreport_max_sz[USBD_HighSpeed]) ||
       (bytes_rece    <  usbd_hid_maxpacketsize[USBD_HighSpeed])) {
     if (usbd_hid_outreport_num <= 1) {  /* If only one out report in system   */
       usbd_hid_set_report (HID_REPORT_OUTPUT,                    0 ,  USBD_HID_OutReport   , DataInReceLen,   USBD_HID_REQ_EP_INT);
@@ -286,6 +291,8 @@ void USBD_HID_Configure_Event (void) {
   DataOutSentLen            = 0;
   DataOutEndWithShortPacket = __FALSE;
 
+  DataOutInEvent            = __FALSE;
+
   ptrDataIn                 = NULL;
   DataInReceLen             = 0;
 
@@ -442,7 +449,7 @@ __task void USBD_RTX_HID_EP_INT_Event (void) {
 
 BOOL usbd_hid_get_report_trigger (U8 rid, U8 *buf, int len) {
 
-  if (len > usbd_hid_inreport_max_sz)
+  if (len > usbd_hid_inreport_max_sz[USBD_HighSpeed])
     return (__FALSE);
 
   if (USBD_Configuration) {
@@ -472,3 +479,32 @@ BOOL usbd_hid_get_report_trigger (U8 rid, U8 *buf, int len) {
 
   return (__FALSE);
 }
+
+
+/*
+ *  USB Device HID Send Report (asynchronous Get_Report request without copy)
+ *   The report is sent straight from the caller's buffer, which must stay
+ *   untouched until usbd_hid_get_report is called with USBD_HID_REQ_EP_INT
+ *   for the next report. May also be called from that callback. Only for
+ *   devices with a single input report (no Report ID is sent).
+ *    Parameters:      buf: Pointer to data buffer
+ *                     len: Number of bytes to be sent
+ *    Return Value:    TRUE - Success, FALSE - Error or previous report busy
+ */
+
+BOOL usbd_hid_send_report (U8 *buf, int len) {
+
+  if ((len > usbd_hid_inreport_max_sz[USBD_HighSpeed]) || (usbd_hid_inreport_num > 1))
+    return (__FALSE);
+
+  if (!USBD_Configuration || DataOutToSendLen || DataOutEndWithShortPacket)
+    return (__FALSE);
+
+  ptrDataOut             = buf;
+  DataOutSentLen         = 0;
+  DataOutToSendLen       = len;
+  USBD_HID_IdleCnt[0]    = 0;
+  if (!DataOutInEvent)                  /* Callback starts sending on return  */
+    USBD_HID_EP_INTIN_Event (0);
+  return (__TRUE);
+}
@@ -40,6 +40,9 @@ U32         Length;                        /* R/W Length */
 U8          BulkStage;                     /* Bulk Stage */
 U32         BulkLen;                       /* Bulk In/Out Length */
 
+BOOL        BulkOutHold;                   /* Bulk Out packets are left in the endpoint */
+BOOL        BulkOutPending;                /* A packet is waiting in the endpoint */
+
 
 /* Dummy Weak Functions that need to be provided by user */
 __weak void usbd_msc_init       ()                                      {};
@@ -222,7 +225,7 @@ void USBD_MSC_MemoryWrite (void) {
     BulkLen = 0;
   }
 
-  if (Offset + BulkLen - 1 > USBD_MSC_BlockSize) {
+  if (Offset + BulkLen > USBD_MSC_BlockGroup * USBD_MSC_BlockSize) {
       // This write would have overflowed USBD_MSC_BlockBuf
       util_assert(0);
       return;
@@ -1004,11 +1007,34 @@ void USBD_MSC_EP_BULKIN_Event (U32 event) {
  */
 
 void USBD_MSC_EP_BULKOUT_Event (U32 event) {
+  if (BulkOutHold) {
+    BulkOutPending = __TRUE;
+    return;
+  }
   BulkLen = USBD_ReadEP(usbd_msc_ep_bulkout, USBD_MSC_BulkBuf);
   USBD_MSC_BulkOut();
 }
 
 
+/*
+ *  USB Device MSC Hold Bulk Out
+ *   While held, packets are not read from the Bulk Out Endpoint so it NAKs
+ *   the host. This lets the user hold off writes until USBD_MSC_BlockBuf
+ *   can take more data without blocking the thread that runs USB.
+ *   Releasing the hold processes a packet that arrived in the meantime.
+ *    Parameters:      hold: __TRUE to hold, __FALSE to release
+ *    Return Value:    None
+ */
+
+void USBD_MSC_BulkOutHold (BOOL hold) {
+  BulkOutHold = hold;
+  if (!hold && BulkOutPending) {
+    BulkOutPending = __FALSE;
+    USBD_MSC_EP_BULKOUT_Event(0);
+  }
+}
+
+
 /*
  *  USB Device MSC Bulk In/Out Endpoint Event Callback
  *    Parameters:      event: USB Device Event
@@ -34,6 +34,7 @@ extern BOOL  usbd_configured            (void);
 /* USB Device user functions imported to USB HID Class module                 */
 extern void  usbd_hid_init              (void);
 extern BOOL  usbd_hid_get_report_trigger(U8 rid,   U8 *buf, int len);
+extern BOOL  usbd_hid_send_report       (U8 *buf, int len);
 extern int   usbd_hid_get_report        (U8 rtype, U8 rid, U8 *buf, U8  req);
 extern void  usbd_hid_set_report        (U8 rtype, U8 rid, U8 *buf, int len, U8 req);
 extern U8    usbd_hid_get_protocol      (void);
@@ -44,6 +45,8 @@ extern void  usbd_msc_init              (void);
 extern void  usbd_msc_read_sect         (U32 block, U8 *buf, U32 num_of_blocks);
 extern void  usbd_msc_write_sect        (U32 block, U8 *buf, U32 num_of_blocks);
 extern void  usbd_msc_start_stop        (BOOL start);
+/* USB Device Mass Storage Class user functions                               */
+extern void  USBD_MSC_BulkOutHold       (BOOL hold);
 
 /* USB Device user functions imported to USB Audio Class module               */
 extern void  usbd_adc_init              (void);
@@ -77,6 +80,14 @@ extern int32_t  USBD_CDC_ACM_GetLineCoding             (void);
 extern int32_t  USBD_CDC_ACM_SetControlLineState       (uint16_t ctrl_bmp);
 extern int32_t  USBD_CDC_ACM_SendBreak                 (uint16_t dur);
 
+/* USB Device user functions imported to USB Bulk Class module                */
+extern void  usbd_bulk_init             (void);
+extern void  usbd_bulk_data_out         (void);
+extern void  usbd_bulk_data_in          (void);
+/* USB Device Bulk class user functions                                       */
+extern int32_t  USBD_BULK_DataRead                     (      uint8_t *buf);
+extern int32_t  USBD_BULK_DataSend                     (const uint8_t *buf, int32_t len);
+
 /* USB Device user functions imported to USB Custom Class module              */
 extern void  usbd_cls_init              (void);
 extern void  usbd_cls_sof               (void);
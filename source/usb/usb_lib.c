@@ -57,6 +57,20 @@ const   U8   usbd_max_packet0           =  USBD_MAX_PACKET0;
   #define USBD_HID_HS_INTERVAL            (2 << ((USBD_HID_HS_BINTERVAL & 0x0F)-1))
 #endif
 
+#ifndef USBD_HID_HS_INREPORT_MAX_SZ
+#define USBD_HID_HS_INREPORT_MAX_SZ    USBD_HID_INREPORT_MAX_SZ
+#endif
+#ifndef USBD_HID_HS_OUTREPORT_MAX_SZ
+#define USBD_HID_HS_OUTREPORT_MAX_SZ   USBD_HID_OUTREPORT_MAX_SZ
+#endif
+#if    (USBD_HS_ENABLE)
+  #define USBD_HID_INREPORT_BUF_SZ   ((USBD_HID_HS_INREPORT_MAX_SZ  > USBD_HID_INREPORT_MAX_SZ ) ? USBD_HID_HS_INREPORT_MAX_SZ  : USBD_HID_INREPORT_MAX_SZ )
+  #define USBD_HID_OUTREPORT_BUF_SZ  ((USBD_HID_HS_OUTREPORT_MAX_SZ > USBD_HID_OUTREPORT_MAX_SZ) ? USBD_HID_HS_OUTREPORT_MAX_SZ : USBD_HID_OUTREPORT_MAX_SZ)
+#else
+  #define USBD_HID_INREPORT_BUF_SZ   USBD_HID_INREPORT_MAX_SZ
+  #define USBD_HID_OUTREPORT_BUF_SZ  USBD_HID_OUTREPORT_MAX_SZ
+#endif
+
 #if    (USBD_HID_ENABLE)
 const   U8   usbd_hid_if_num            =  USBD_HID_IF_NUM;
 const   U8   usbd_hid_ep_intin          =  USBD_HID_EP_INTIN;
@@ -65,15 +79,15 @@ const   U16  usbd_hid_interval     [2]  = {USBD_HID_INTERVAL,       USBD_HID_HS_
 const   U16  usbd_hid_maxpacketsize[2]  = {USBD_HID_WMAXPACKETSIZE, USBD_HID_HS_WMAXPACKETSIZE};
 const   U8   usbd_hid_inreport_num      =  USBD_HID_INREPORT_NUM;
 const   U8   usbd_hid_outreport_num     =  USBD_HID_OUTREPORT_NUM;
-const   U16  usbd_hid_inreport_max_sz   =  USBD_HID_INREPORT_MAX_SZ;
-const   U16  usbd_hid_outreport_max_sz  =  USBD_HID_OUTREPORT_MAX_SZ;
+const   U16  usbd_hid_inreport_max_sz  [2] = {USBD_HID_INREPORT_MAX_SZ,  USBD_HID_HS_INREPORT_MAX_SZ};
+const   U16  usbd_hid_outreport_max_sz [2] = {USBD_HID_OUTREPORT_MAX_SZ, USBD_HID_HS_OUTREPORT_MAX_SZ};
 const   U16  usbd_hid_featreport_max_sz =  USBD_HID_FEATREPORT_MAX_SZ;
         U16  USBD_HID_PollingCnt;
         U8   USBD_HID_IdleCnt             [USBD_HID_INREPORT_NUM];
         U8   USBD_HID_IdleReload          [USBD_HID_INREPORT_NUM];
         U8   USBD_HID_IdleSet             [USBD_HID_INREPORT_NUM];
-        U8   USBD_HID_InReport            [USBD_HID_INREPORT_MAX_SZ+1];
-        U8   USBD_HID_OutReport           [USBD_HID_OUTREPORT_MAX_SZ+1];
+        U8   USBD_HID_InReport            [USBD_HID_INREPORT_BUF_SZ+1];
+        U8   USBD_HID_OutReport           [USBD_HID_OUTREPORT_BUF_SZ+1];
         U8   USBD_HID_FeatReport          [USBD_HID_FEATREPORT_MAX_SZ+1];
 #endif
 
@@ -121,6 +135,17 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
         U8   USBD_CDC_ACM_NotifyBuf       [10];
 #endif
 
+#ifndef USBD_BULK_ENABLE
+#define USBD_BULK_ENABLE  0
+#endif
+
+#if    (USBD_BULK_ENABLE)
+const   U8   usbd_bulk_if_num           =  USBD_BULK_IF_NUM;
+const   U8   usbd_bulk_ep_bulkin        =  USBD_BULK_EP_BULKIN;
+const   U8   usbd_bulk_ep_bulkout       =  USBD_BULK_EP_BULKOUT;
+const   U16  usbd_bulk_maxpacketsize[2] = {USBD_BULK_WMAXPACKETSIZE, USBD_BULK_HS_WMAXPACKETSIZE};
+#endif
+
 /*------------------------------------------------------------------------------
  *      USB Device Override Event Handler Fuctions
  *----------------------------------------------------------------------------*/
@@ -876,6 +901,206 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
   BOOL USBD_EndPoint0_Out_CDC_ReqToIF (void)                                        { return (__FALSE); }
 #endif  /* (USBD_CDC_ACM_ENABLE) */
 
+#if    (USBD_BULK_ENABLE)
+  #ifdef __RTX
+    #if    (USBD_BULK_EP_BULKIN != USBD_BULK_EP_BULKOUT)
+      #if    (USBD_BULK_EP_BULKIN == 1)
+        #define USBD_RTX_EndPoint1             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 2)
+        #define USBD_RTX_EndPoint2             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 3)
+        #define USBD_RTX_EndPoint3             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 4)
+        #define USBD_RTX_EndPoint4             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 5)
+        #define USBD_RTX_EndPoint5             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 6)
+        #define USBD_RTX_EndPoint6             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 7)
+        #define USBD_RTX_EndPoint7             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 8)
+        #define USBD_RTX_EndPoint8             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 9)
+        #define USBD_RTX_EndPoint9             USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 10)
+        #define USBD_RTX_EndPoint10            USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 11)
+        #define USBD_RTX_EndPoint11            USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 12)
+        #define USBD_RTX_EndPoint12            USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 13)
+        #define USBD_RTX_EndPoint13            USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 14)
+        #define USBD_RTX_EndPoint14            USBD_RTX_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 15)
+        #define USBD_RTX_EndPoint15            USBD_RTX_BULK_EP_BULKIN_Event
+      #endif
+
+      #if    (USBD_BULK_EP_BULKOUT == 1)
+        #define USBD_RTX_EndPoint1             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 2)
+        #define USBD_RTX_EndPoint2             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 3)
+        #define USBD_RTX_EndPoint3             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 4)
+        #define USBD_RTX_EndPoint4             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 5)
+        #define USBD_RTX_EndPoint5             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 6)
+        #define USBD_RTX_EndPoint6             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 7)
+        #define USBD_RTX_EndPoint7             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 8)
+        #define USBD_RTX_EndPoint8             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 9)
+        #define USBD_RTX_EndPoint9             USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 10)
+        #define USBD_RTX_EndPoint10            USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 11)
+        #define USBD_RTX_EndPoint11            USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 12)
+        #define USBD_RTX_EndPoint12            USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 13)
+        #define USBD_RTX_EndPoint13            USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 14)
+        #define USBD_RTX_EndPoint14            USBD_RTX_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 15)
+        #define USBD_RTX_EndPoint15            USBD_RTX_BULK_EP_BULKOUT_Event
+      #endif
+    #else
+      #if    (USBD_BULK_EP_BULKIN == 1)
+        #define USBD_RTX_EndPoint1             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 2)
+        #define USBD_RTX_EndPoint2             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 3)
+        #define USBD_RTX_EndPoint3             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 4)
+        #define USBD_RTX_EndPoint4             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 5)
+        #define USBD_RTX_EndPoint5             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 6)
+        #define USBD_RTX_EndPoint6             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 7)
+        #define USBD_RTX_EndPoint7             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 8)
+        #define USBD_RTX_EndPoint8             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 9)
+        #define USBD_RTX_EndPoint9             USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 10)
+        #define USBD_RTX_EndPoint10            USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 11)
+        #define USBD_RTX_EndPoint11            USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 12)
+        #define USBD_RTX_EndPoint12            USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 13)
+        #define USBD_RTX_EndPoint13            USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 14)
+        #define USBD_RTX_EndPoint14            USBD_RTX_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 15)
+        #define USBD_RTX_EndPoint15            USBD_RTX_BULK_EP_BULK_Event
+      #endif
+    #endif
+  #else
+    #if    (USBD_BULK_EP_BULKIN != USBD_BULK_EP_BULKOUT)
+      #if    (USBD_BULK_EP_BULKIN == 1)
+        #define USBD_EndPoint1                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 2)
+        #define USBD_EndPoint2                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 3)
+        #define USBD_EndPoint3                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 4)
+        #define USBD_EndPoint4                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 5)
+        #define USBD_EndPoint5                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 6)
+        #define USBD_EndPoint6                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 7)
+        #define USBD_EndPoint7                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 8)
+        #define USBD_EndPoint8                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 9)
+        #define USBD_EndPoint9                 USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 10)
+        #define USBD_EndPoint10                USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 11)
+        #define USBD_EndPoint11                USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 12)
+        #define USBD_EndPoint12                USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 13)
+        #define USBD_EndPoint13                USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 14)
+        #define USBD_EndPoint14                USBD_BULK_EP_BULKIN_Event
+      #elif  (USBD_BULK_EP_BULKIN == 15)
+        #define USBD_EndPoint15                USBD_BULK_EP_BULKIN_Event
+      #endif
+
+      #if    (USBD_BULK_EP_BULKOUT == 1)
+        #define USBD_EndPoint1                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 2)
+        #define USBD_EndPoint2                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 3)
+        #define USBD_EndPoint3                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 4)
+        #define USBD_EndPoint4                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 5)
+        #define USBD_EndPoint5                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 6)
+        #define USBD_EndPoint6                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 7)
+        #define USBD_EndPoint7                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 8)
+        #define USBD_EndPoint8                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 9)
+        #define USBD_EndPoint9                 USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 10)
+        #define USBD_EndPoint10                USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 11)
+        #define USBD_EndPoint11                USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 12)
+        #define USBD_EndPoint12                USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 13)
+        #define USBD_EndPoint13                USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 14)
+        #define USBD_EndPoint14                USBD_BULK_EP_BULKOUT_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 15)
+        #define USBD_EndPoint15                USBD_BULK_EP_BULKOUT_Event
+      #endif
+    #else
+      #if    (USBD_BULK_EP_BULKIN == 1)
+        #define USBD_EndPoint1                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 2)
+        #define USBD_EndPoint2                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 3)
+        #define USBD_EndPoint3                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 4)
+        #define USBD_EndPoint4                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 5)
+        #define USBD_EndPoint5                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 6)
+        #define USBD_EndPoint6                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 7)
+        #define USBD_EndPoint7                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 8)
+        #define USBD_EndPoint8                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 9)
+        #define USBD_EndPoint9                 USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 10)
+        #define USBD_EndPoint10                USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 11)
+        #define USBD_EndPoint11                USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 12)
+        #define USBD_EndPoint12                USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 13)
+        #define USBD_EndPoint13                USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 14)
+        #define USBD_EndPoint14                USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKIN == 15)
+        #define USBD_EndPoint15                USBD_BULK_EP_BULK_Event
+      #endif
+    #endif
+  #endif
+#endif  /* (USBD_BULK_ENABLE) */
+
 #if    (USBD_CLS_ENABLE)
 #else
   BOOL USBD_EndPoint0_Setup_CLS_ReqToDEV  (void)                                        { return (__FALSE); }
@@ -1164,6 +1389,9 @@ void usbd_class_init     (void)                                       {
 #if (USBD_CDC_ACM_ENABLE)
                                                                         USBD_CDC_ACM_Initialize();
 #endif
+#if (USBD_BULK_ENABLE)
+                                                                        usbd_bulk_init();
+#endif
 #if (USBD_CLS_ENABLE)
                                                                         usbd_cls_init();
 #endif
@@ -1210,6 +1438,12 @@ typedef struct {
 #if !defined(USBD_CDC_ACM_EP_BULKOUT_STACK)
   #define USBD_CDC_ACM_EP_BULKOUT_STACK 0
 #endif
+#if !defined(USBD_BULK_EP_BULKIN_STACK)
+  #define USBD_BULK_EP_BULKIN_STACK 0
+#endif
+#if !defined(USBD_BULK_EP_BULKOUT_STACK)
+  #define USBD_BULK_EP_BULKOUT_STACK 0
+#endif
 
 #if USBD_HID_EP_INTIN == 0 && USBD_HID_EP_INTIN_STACK > 0
   #error "USBD_HID_EP_INTIN stack unused - must be 0"
@@ -1235,6 +1469,12 @@ typedef struct {
 #if USBD_CDC_ACM_EP_BULKOUT == 0 && USBD_CDC_ACM_EP_BULKOUT_STACK > 0
   #error "USBD_CDC_ACM_EP_BULKOUT stack unused - must be 0"
 #endif
+#if USBD_BULK_EP_BULKIN == 0 && USBD_BULK_EP_BULKIN_STACK > 0
+  #error "USBD_BULK_EP_BULKIN stack unused - must be 0"
+#endif
+#if USBD_BULK_EP_BULKOUT == 0 && USBD_BULK_EP_BULKOUT_STACK > 0
+  #error "USBD_BULK_EP_BULKOUT stack unused - must be 0"
+#endif
 
 #if USBD_ENABLE
   static U64 usbd_core_stack[USBD_RTX_CORE_STACK/8];
@@ -1266,6 +1506,12 @@ typedef struct {
 #if (USBD_CDC_ACM_EP_BULKOUT_STACK > 0)
   static U64 usbd_cdc_acm_ep_bulkout_stack[USBD_CDC_ACM_EP_BULKOUT_STACK/8];
 #endif
+#if (USBD_BULK_EP_BULKIN_STACK > 0)
+  static U64 usbd_bulk_ep_bulkin_stack[USBD_BULK_EP_BULKIN_STACK/8];
+#endif
+#if (USBD_BULK_EP_BULKOUT_STACK > 0)
+  static U64 usbd_bulk_ep_bulkout_stack[USBD_BULK_EP_BULKOUT_STACK/8];
+#endif
 
 // Check HID
 #if (USBD_HID_ENABLE && !USBD_HID_EP_INTIN_STACK && USBD_HID_EP_INTIN != USBD_HID_EP_INTOUT)
@@ -1317,6 +1563,20 @@ typedef struct {
   #error "Multiple CDC stacks defined for same EP"
 #endif
 
+// Check Bulk
+#if (USBD_BULK_ENABLE && !USBD_BULK_EP_BULKIN_STACK && USBD_BULK_EP_BULKIN != USBD_BULK_EP_BULKOUT)
+  #error "USBD_BULK_EP_BULKIN_STACK must be defined"
+#endif
+#if (USBD_BULK_ENABLE && !USBD_BULK_EP_BULKOUT_STACK && USBD_BULK_EP_BULKIN != USBD_BULK_EP_BULKOUT)
+  #error "USBD_BULK_EP_BULKOUT_STACK must be defined"
+#endif
+#if (USBD_BULK_ENABLE && USBD_BULK_EP_BULKIN_STACK == 0 && USBD_BULK_EP_BULKOUT_STACK == 0)
+  #error "Bulk stack must be defined"
+#endif
+#if (USBD_BULK_EP_BULKIN_STACK > 0 && USBD_BULK_EP_BULKOUT_STACK > 0 && USBD_BULK_EP_BULKIN == USBD_BULK_EP_BULKOUT)
+  #error "Multiple Bulk stacks defined for same EP"
+#endif
+
 static const user_stack_t user_stack_list[16] = {
   #if USBD_ENABLE 
     [0] = {usbd_endpoint0_stack, sizeof(usbd_endpoint0_stack)},
@@ -1345,6 +1605,12 @@ static const user_stack_t user_stack_list[16] = {
   #if (USBD_CDC_ACM_EP_BULKOUT_STACK > 0)
     [USBD_CDC_ACM_EP_BULKOUT] = {usbd_cdc_acm_ep_bulkout_stack, sizeof(usbd_cdc_acm_ep_bulkout_stack)},
   #endif
+  #if (USBD_BULK_EP_BULKIN_STACK > 0)
+    [USBD_BULK_EP_BULKIN] = {usbd_bulk_ep_bulkin_stack, sizeof(usbd_bulk_ep_bulkin_stack)},
+  #endif
+  #if (USBD_BULK_EP_BULKOUT_STACK > 0)
+    [USBD_BULK_EP_BULKOUT] = {usbd_bulk_ep_bulkout_stack, sizeof(usbd_bulk_ep_bulkout_stack)},
+  #endif
 };
 
 #endif /* __RTX */
@@ -1403,13 +1669,15 @@ void USBD_RTX_TaskInit (void) {
                                            USB_INTERFACE_DESC_SIZE + USB_ENDPOINT_DESC_SIZE + USB_ENDPOINT_DESC_SIZE)
 #define USBD_HID_DESC_LEN                 (USB_INTERFACE_DESC_SIZE + USB_HID_DESC_SIZE                                                          + \
                                           (USB_ENDPOINT_DESC_SIZE*(1+(USBD_HID_EP_INTOUT != 0))))
+#define USBD_BULK_DESC_LEN                (USB_INTERFACE_DESC_SIZE + 2*USB_ENDPOINT_DESC_SIZE)
 #define USBD_HID_DESC_OFS                 (USB_CONFIGUARTION_DESC_SIZE + USB_INTERFACE_DESC_SIZE                                                + \
                                            USBD_MSC_ENABLE * USBD_MSC_DESC_LEN + USBD_CDC_ACM_ENABLE * USBD_CDC_ACM_DESC_LEN)
 
 #define USBD_WTOTALLENGTH                 (USB_CONFIGUARTION_DESC_SIZE +                 \
                                            USBD_CDC_ACM_DESC_LEN * USBD_CDC_ACM_ENABLE + \
                                            USBD_HID_DESC_LEN     * USBD_HID_ENABLE     + \
-                                           USBD_MSC_DESC_LEN     * USBD_MSC_ENABLE)
+                                           USBD_MSC_DESC_LEN     * USBD_MSC_ENABLE     + \
+                                           USBD_BULK_DESC_LEN    * USBD_BULK_ENABLE)
 
 /*------------------------------------------------------------------------------
   Default HID Report Descriptor
@@ -1461,6 +1729,47 @@ const U8 USBD_HID_ReportDescriptor[] = {
 __weak \
 const U16 USBD_HID_ReportDescriptorSize = sizeof(USBD_HID_ReportDescriptor);
 
+#if (USBD_HS_ENABLE)
+/* HID Report Descriptor for High Speed */
+__weak \
+const U8 USBD_HID_ReportDescriptor_HS[] = {
+  HID_UsagePageVendor( 0x00                         ),
+  HID_Usage          ( 0x01                         ),
+  HID_Collection     ( HID_Application              ),
+    HID_LogicalMin   ( 0                            ), /* value range: 0 - 0xFF */
+    HID_LogicalMaxS  ( 0xFF                         ),
+    HID_ReportSize   ( 8                            ), /* 8 bits */
+#if (USBD_HID_HS_INREPORT_MAX_SZ > 255)
+    HID_ReportCountS ( USBD_HID_HS_INREPORT_MAX_SZ  ),
+#else
+    HID_ReportCount  ( USBD_HID_HS_INREPORT_MAX_SZ  ),
+#endif
+    HID_Usage        ( 0x01                         ),
+    HID_Input        ( HID_Data | HID_Variable | HID_Absolute ),
+#if (USBD_HID_HS_OUTREPORT_MAX_SZ > 255)
+    HID_ReportCountS ( USBD_HID_HS_OUTREPORT_MAX_SZ ),
+#else
+    HID_ReportCount  ( USBD_HID_HS_OUTREPORT_MAX_SZ ),
+#endif
+    HID_Usage        ( 0x01                         ),
+    HID_Output       ( HID_Data | HID_Variable | HID_Absolute ),
+#if (USBD_HID_FEATREPORT_MAX_SZ > 255)
+    HID_ReportCountS ( USBD_HID_FEATREPORT_MAX_SZ   ),
+#else
+    HID_ReportCount  ( USBD_HID_FEATREPORT_MAX_SZ   ),
+#endif
+    HID_Usage        ( 0x01                         ),
+    HID_Feature      ( HID_Data | HID_Variable | HID_Absolute ),
+  HID_EndCollection,
+};
+#else
+__weak \
+const U8 USBD_HID_ReportDescriptor_HS[] = { 0 };
+#endif
+
+__weak \
+const U16 USBD_HID_ReportDescriptorSize_HS = sizeof(USBD_HID_ReportDescriptor_HS);
+
 __weak \
 const U16 USBD_HID_DescriptorOffset     = USBD_HID_DESC_OFS;
 
@@ -1535,7 +1844,10 @@ __weak \
 const U8 USBD_DeviceQualifier_HS[] = { 0 };
 #endif
 
-#define HID_DESC                                                                                            \
+#define HID_DESC                        HID_DESC_REPORT(USB_HID_REPORT_DESC_SIZE)
+#define HID_DESC_HS                     HID_DESC_REPORT(USB_HID_REPORT_DESC_SIZE_HS)
+
+#define HID_DESC_REPORT(report_desc_size)                                                                   \
   /* Interface, Alternate Setting 0, HID Class */                                                           \
   USB_INTERFACE_DESC_SIZE,              /* bLength */                                                       \
   USB_INTERFACE_DESCRIPTOR_TYPE,        /* bDescriptorType */                                               \
@@ -1554,7 +1866,7 @@ const U8 USBD_DeviceQualifier_HS[] = { 0 };
   0x00,                                 /* bCountryCode */                                                  \
   0x01,                                 /* bNumDescriptors */                                               \
   HID_REPORT_DESCRIPTOR_TYPE,           /* bDescriptorType */                                               \
-  WBVAL(USB_HID_REPORT_DESC_SIZE),      /* wDescriptorLength */
+  WBVAL(report_desc_size),              /* wDescriptorLength */
 
 #define HID_EP                          /* HID Endpoint for Low-speed/Full-speed */                         \
 /* Endpoint, HID Interrupt In */                                                                            \
@@ -1654,6 +1966,52 @@ const U8 USBD_DeviceQualifier_HS[] = { 0 };
   WBVAL(USBD_MSC_HS_WMAXPACKETSIZE),    /* wMaxPacketSize */                                                \
   USBD_MSC_HS_BINTERVAL,                /* bInterval */
 
+#define BULK_DESC                                                                                           \
+/* Interface, Alternate Setting 0, Vendor Specific Class */                                                 \
+  USB_INTERFACE_DESC_SIZE,              /* bLength */                                                       \
+  USB_INTERFACE_DESCRIPTOR_TYPE,        /* bDescriptorType */                                               \
+  USBD_BULK_IF_NUM,                     /* bInterfaceNumber */                                              \
+  0x00,                                 /* bAlternateSetting */                                             \
+  0x02,                                 /* bNumEndpoints */                                                 \
+  USB_DEVICE_CLASS_VENDOR_SPECIFIC,     /* bInterfaceClass */                                               \
+  0x00,                                 /* bInterfaceSubClass */                                            \
+  0x00,                                 /* bInterfaceProtocol */                                            \
+  USBD_BULK_IF_STR_NUM,                 /* iInterface */
+
+#define BULK_EP                         /* Bulk Endpoints for Low-speed/Full-speed */                       \
+/* Endpoint, EP Bulk OUT */                                                                                 \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_OUT(USBD_BULK_EP_BULKOUT),/* bEndpointAddress */                                             \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */                           \
+                                                                                                            \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */
+
+#define BULK_EP_HS                      /* Bulk Endpoints for High-speed */                                 \
+/* Endpoint, EP Bulk OUT */                                                                                 \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_OUT(USBD_BULK_EP_BULKOUT),/* bEndpointAddress */                                             \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_HS_WMAXPACKETSIZE),   /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */                           \
+                                                                                                            \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_HS_WMAXPACKETSIZE),   /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */
+
 #define ADC_DESC_IAD(first,num_of_ifs)  /* ADC: Interface Association Descriptor */                         \
   USB_INTERFACE_ASSOC_DESC_SIZE,        /* bLength */                                                       \
   USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE,  /* bDescriptorType */                                         \
@@ -1958,6 +2316,11 @@ const U8 USBD_ConfigDescriptor[] = {
   CDC_ACM_EP_IF1
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 /* Terminator */                                                                                            \
   0                                     /* bLength */                                                       \
 };
@@ -2000,7 +2363,7 @@ const U8 USBD_ConfigDescriptor_HS[] = {
 #endif
 
 #if (USBD_HID_ENABLE)
-  HID_DESC
+  HID_DESC_HS
 #if (USBD_HID_EP_INTOUT != 0)
   HID_EP_INOUT_HS
 #else
@@ -2018,6 +2381,11 @@ const U8 USBD_ConfigDescriptor_HS[] = {
   CDC_ACM_EP_IF1_HS
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP_HS
+#endif
+
 /* Terminator */                                                                                            \
   0                                     /* bLength */                                                       \
 };
@@ -2056,7 +2424,7 @@ const U8 USBD_OtherSpeedConfigDescriptor[] = {
 #endif
 
 #if (USBD_HID_ENABLE)
-  HID_DESC
+  HID_DESC_HS
 #if (USBD_HID_EP_INTOUT != 0)
   HID_EP_INOUT_HS
 #else
@@ -2069,6 +2437,11 @@ const U8 USBD_OtherSpeedConfigDescriptor[] = {
   MSC_EP_HS
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP_HS
+#endif
+
 /* Terminator */
   0                                     /* bLength */
 };
@@ -2120,6 +2493,11 @@ const U8 USBD_OtherSpeedConfigDescriptor_HS[] = {
   MSC_EP
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 /* Terminator */
   0                                     /* bLength */
 };
@@ -2163,6 +2541,9 @@ const struct {
 #if (USBD_MSC_ENABLE)
   USBD_STR_DEF(MSC_STRDESC);
 #endif
+#if (USBD_BULK_ENABLE)
+  USBD_STR_DEF(BULK_STRDESC);
+#endif
 } USBD_StringDescriptor
   =
 {
@@ -2187,6 +2568,9 @@ const struct {
 #if (USBD_MSC_ENABLE)
   USBD_STR_VAL(MSC_STRDESC),
 #endif
+#if (USBD_BULK_ENABLE)
+  USBD_STR_VAL(BULK_STRDESC),
+#endif
 };
 
 #endif
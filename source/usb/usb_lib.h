@@ -39,8 +39,8 @@ extern const U16  usbd_hid_interval     [2];
 extern const U16  usbd_hid_maxpacketsize[2];
 extern const U8   usbd_hid_inreport_num;
 extern const U8   usbd_hid_outreport_num;
-extern const U16  usbd_hid_inreport_max_sz;
-extern const U16  usbd_hid_outreport_max_sz;
+extern const U16  usbd_hid_inreport_max_sz [2];
+extern const U16  usbd_hid_outreport_max_sz[2];
 extern const U16  usbd_hid_featreport_max_sz;
 extern       U16  USBD_HID_PollingCnt;
 extern       U16  USBD_HID_PollingReload[];
@@ -85,6 +85,11 @@ extern        U8  USBD_CDC_ACM_SendBuf       [];
 extern        U8  USBD_CDC_ACM_ReceiveBuf    [];
 extern        U8  USBD_CDC_ACM_NotifyBuf     [10];
 
+extern const U8   usbd_bulk_if_num;
+extern const U8   usbd_bulk_ep_bulkin;
+extern const U8   usbd_bulk_ep_bulkout;
+extern const U16  usbd_bulk_maxpacketsize[2];
+
 extern       void usbd_os_evt_set       (U16 event_flags, U32 task);
 extern       U16  usbd_os_evt_get       (void);
 extern       U32  usbd_os_evt_wait_or   (U16 wait_flags, U16 timeout);
@@ -97,6 +102,8 @@ extern const BOOL __rtx;
  *----------------------------------------------------------------------------*/
 extern const U8   USBD_HID_ReportDescriptor[];
 extern const U16  USBD_HID_ReportDescriptorSize;
+extern const U8   USBD_HID_ReportDescriptor_HS[];
+extern const U16  USBD_HID_ReportDescriptorSize_HS;
 extern const U16  USBD_HID_DescriptorOffset;
 extern const U8   USBD_DeviceDescriptor[];
 extern const U8   USBD_DeviceQualifier[];
@@ -26,5 +26,6 @@
 #define USB_ENDPOINT_DESC_SIZE            (sizeof(USB_ENDPOINT_DESCRIPTOR))
 #define USB_HID_DESC_SIZE                 (sizeof(HID_DESCRIPTOR))
 #define USB_HID_REPORT_DESC_SIZE          (sizeof(USBD_HID_ReportDescriptor))
+#define USB_HID_REPORT_DESC_SIZE_HS       (sizeof(USBD_HID_ReportDescriptor_HS))
 
 #endif  /* __USBD_DESC_H__ */
@@ -0,0 +1,175 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DAP_CONFIG_H__
+#define __DAP_CONFIG_H__
+
+// DAP configuration of the host simulation build. DAP.c and SW_DP.c are
+// compiled unchanged, the I/O pin functions drive the virtual target of
+// swd_target.c instead of a GPIO port.
+
+#include <stdint.h>
+#include "swd_target.h"
+
+// ARM compiler keywords used by the engine
+#define __weak                  __attribute__((weak))
+#define __inline                inline
+#define __forceinline           inline __attribute__((always_inline))
+#define __nop()                 __asm__ volatile ("")
+
+// No DWT cycle counter: DAP_StatsTimer() reads os_time from swd_target.c
+#define __CORTEX_M              0x00
+
+// SysTick stand-in for the SWJ_Pins timeout
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+extern SysTick_Type sim_systick;
+#define SysTick                         (&sim_systick)
+#define SysTick_CTRL_ENABLE_Pos         0
+#define SysTick_CTRL_CLKSOURCE_Pos      2
+#define SysTick_CTRL_COUNTFLAG_Msk      (1UL << 16)
+
+#define CPU_CLOCK               48000000        ///< Specifies the CPU Clock in Hz
+#define IO_PORT_WRITE_CYCLES    2               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
+#define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
+#define DAP_JTAG                0               ///< JTAG Mode: 0 = not available
+#define DAP_JTAG_DEV_CNT        8               ///< Maximum number of JTAG devices on scan chain
+#ifndef DAP_STATS
+#define DAP_STATS               1               ///< Statistics: 1 = counted, 0 = not counted
+#endif
+#define DAP_DEFAULT_PORT        1               ///< Default JTAG/SWJ Port Mode: 1 = SWD, 2 = JTAG.
+#define DAP_DEFAULT_SWJ_CLOCK   5000000         ///< Default SWD/JTAG clock frequency in Hz.
+#define DAP_PACKET_SIZE         64              ///< USB: 64 = Full-Speed, 1024 = High-Speed.
+#define DAP_PACKET_COUNT        1               ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
+#define TARGET_DEVICE_FIXED     0               ///< Target Device: 1 = known, 0 = unknown;
+
+// Port setup ------------------------------------------
+
+static __inline void PORT_JTAG_SETUP (void) {
+    sim_swdio_oe(0);
+}
+
+static __inline void PORT_SWD_SETUP (void) {
+    sim_swclk(1);
+    sim_swdio_out(1);
+    sim_swdio_oe(1);
+    sim_nreset_out(1);
+}
+
+static __inline void PORT_OFF (void) {
+    sim_swdio_oe(0);
+}
+
+// SWCLK/TCK I/O pin -----------------------------------
+
+static __forceinline uint32_t PIN_SWCLK_TCK_IN  (void) {
+    return sim_swclk_in();
+}
+
+static __forceinline void     PIN_SWCLK_TCK_SET (void) {
+    sim_swclk(1);
+}
+
+static __forceinline void     PIN_SWCLK_TCK_CLR (void) {
+    sim_swclk(0);
+}
+
+// SWDIO/TMS Pin I/O -----------------------------------
+
+static __forceinline uint32_t PIN_SWDIO_TMS_IN  (void) {
+    return sim_swdio_in();
+}
+
+static __forceinline void     PIN_SWDIO_TMS_SET (void) {
+    sim_swdio_out(1);
+}
+
+static __forceinline void     PIN_SWDIO_TMS_CLR (void) {
+    sim_swdio_out(0);
+}
+
+static __forceinline uint32_t PIN_SWDIO_IN      (void) {
+    return sim_swdio_in();
+}
+
+static __forceinline void     PIN_SWDIO_OUT     (uint32_t bit) {
+    sim_swdio_out(bit);
+}
+
+static __forceinline void     PIN_SWDIO_OUT_ENABLE  (void) {
+    sim_swdio_oe(1);
+}
+
+static __forceinline void     PIN_SWDIO_OUT_DISABLE (void) {
+    sim_swdio_oe(0);
+}
+
+// JTAG only pins --------------------------------------
+
+static __forceinline uint32_t PIN_TDI_IN  (void) {
+    return (0);   // Not available
+}
+
+static __forceinline void     PIN_TDI_OUT (uint32_t bit) {
+    ;             // Not available
+}
+
+static __forceinline uint32_t PIN_TDO_IN  (void) {
+    return (0);   // Not available
+}
+
+static __forceinline uint32_t PIN_nTRST_IN   (void) {
+    return (0);   // Not available
+}
+
+static __forceinline void     PIN_nTRST_OUT  (uint32_t bit) {
+    ;             // Not available
+}
+
+// nRESET Pin I/O --------------------------------------
+
+static __forceinline uint32_t PIN_nRESET_IN  (void) {
+    return sim_nreset_in();
+}
+
+static __forceinline void     PIN_nRESET_OUT (uint32_t bit) {
+    sim_nreset_out(bit);
+}
+
+// LEDs and setup --------------------------------------
+
+static __inline void LED_CONNECTED_OUT (uint32_t bit) {
+    ;             // Not available
+}
+
+static __inline void LED_RUNNING_OUT (uint32_t bit) {
+    ;             // Not available
+}
+
+static __inline void DAP_SETUP (void) {
+    ;
+}
+
+static __inline uint32_t RESET_TARGET (void) {
+    return (0);
+}
+
+#endif /* __DAP_CONFIG_H__ */
@@ -0,0 +1,576 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays DAP command streams against the virtual target and reports the
+// transfer rate of the host build together with the SWCLK cycles spent per
+// transfer. The cycle counts do not depend on the host machine, so they are
+// the number to compare between engine changes; the rate is only a guide.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DAP_config.h"
+#include "DAP.h"
+#include "debug_cm.h"
+#include "swd_host.h"
+#include "target_config.h"
+#include "swd_target.h"
+
+#define BLOCK_WORDS         12          // TransferBlock words next to a TAR write in 64 bytes
+#define WINDOW_BLOCKS       256         // Blocks before the benchmarks wrap in RAM
+#define HOST_BLOCK_SIZE     4096        // swd_host.c memory test size
+#define REPLAY_MAX          1024        // Commands in a replay file
+
+#define DP_REQ(rnw, reg)    ((((rnw) ? 1 : 0) << 1) | (reg))
+#define AP_REQ(rnw, reg)    (1 | (((rnw) ? 1 : 0) << 1) | (reg))
+
+// Flash algorithm stand-in, the virtual core does not execute it
+static const uint32_t sim_algo_blob[] = {
+    0xE00ABE00, 0x062D780D, 0x24084068, 0xD3000040, 0x1E644058, 0x1C49D1FA, 0x2A001E52, 0x4770D1F2,
+};
+
+static const program_target_t sim_algo = {
+    0x20000021, // Init
+    0x20000025, // UnInit
+    0x20000029, // EraseChip
+    0x2000002D, // EraseSector
+    0x20000031, // ProgramPage
+    {
+        0x20000001, // breakpoint instruction address
+        0x20000400, // static base register value
+        0x20000800  // initial stack pointer
+    },
+    0x20001000, // program_buffer
+    0x20000000, // algo_start
+    sizeof(sim_algo_blob), // algo_size
+    sim_algo_blob, // image
+    256         // program_buffer_size
+};
+
+// swd_host.c links against the target support of a real board
+const target_cfg_t target_device = {
+    .sector_size = 1024,
+    .sector_cnt = SIM_FLASH_SIZE / 1024,
+    .flash_start = SIM_FLASH_START,
+    .flash_end = SIM_FLASH_START + SIM_FLASH_SIZE,
+    .ram_start = SIM_RAM_START,
+    .ram_end = SIM_RAM_START + SIM_RAM_SIZE,
+    .flash_algo = (program_target_t *)&sim_algo,
+};
+
+void target_before_init_debug(void) {
+}
+
+uint8_t target_unlock_sequence(void) {
+    return 1;
+}
+
+static uint8_t request[DAP_PACKET_SIZE];
+static uint8_t response[DAP_PACKET_SIZE];
+static uint32_t iterations = 1000;
+static uint32_t swj_clock = 10000000;
+static int failed;
+
+typedef struct {
+    uint32_t len;
+    uint8_t data[DAP_PACKET_SIZE];
+} replay_cmd_t;
+
+static replay_cmd_t replay[REPLAY_MAX];
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t val) {
+    *p++ = (uint8_t)(val >> 0);
+    *p++ = (uint8_t)(val >> 8);
+    *p++ = (uint8_t)(val >> 16);
+    *p++ = (uint8_t)(val >> 24);
+    return p;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failed = 1;
+    }
+}
+
+static uint32_t execute(uint8_t *req) {
+    return DAP_ExecuteCommand(req, response);
+}
+
+static void report(const char *name, uint32_t commands, double elapsed) {
+    uint32_t transfers = sim_target_stats.ok;
+
+    printf("%-16s %8u cmds %9u xfers %10.0f xfers/s %7.1f clk/xfer %6u wait %5u fault\n",
+           name, commands, transfers,
+           elapsed > 0 ? transfers / elapsed : 0.0,
+           transfers ? (double)sim_target_stats.swclk_cycles / transfers : 0.0,
+           sim_target_stats.wait, sim_target_stats.fault);
+}
+
+// Connect, switch to SWD, power up the debug domain and set up the MEM-AP
+static void connect(void) {
+    uint8_t *p;
+
+    p = request;
+    *p++ = ID_DAP_Connect;
+    *p++ = DAP_PORT_SWD;
+    execute(request);
+    check(response[1] == DAP_PORT_SWD, "connect");
+
+    p = request;
+    *p++ = ID_DAP_SWJ_Clock;
+    p = put32(p, swj_clock);
+    execute(request);
+
+    p = request;
+    *p++ = ID_DAP_SWJ_Sequence;
+    *p++ = 51;
+    memset(p, 0xFF, 7);
+    execute(request);
+    p = request + 1;
+    *p++ = 16;
+    *p++ = 0x9E;
+    *p++ = 0xE7;
+    execute(request);
+    p = request + 1;
+    *p++ = 51;
+    memset(p, 0xFF, 7);
+    execute(request);
+    p = request + 1;
+    *p++ = 8;
+    *p++ = 0x00;
+    execute(request);
+
+    p = request;
+    *p++ = ID_DAP_Transfer;
+    *p++ = 0;
+    *p++ = 6;
+    *p++ = DP_REQ(1, DP_IDCODE);
+    *p++ = DP_REQ(0, DP_ABORT);
+    p = put32(p, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+    *p++ = DP_REQ(0, DP_SELECT);
+    p = put32(p, 0);
+    *p++ = DP_REQ(0, DP_CTRL_STAT);
+    p = put32(p, CSYSPWRUPREQ | CDBGPWRUPREQ);
+    *p++ = DP_REQ(1, DP_CTRL_STAT);
+    *p++ = AP_REQ(0, AP_CSW);
+    p = put32(p, CSW_RESERVED | CSW_MSTRDBG | CSW_HPROT | CSW_DBGSTAT | CSW_SADDRINC | CSW_SIZE32);
+    execute(request);
+    check((response[1] == 6) && (response[2] == DAP_TRANSFER_OK), "power up");
+    check(get32(&response[3]) == SIM_IDCODE, "IDCODE");
+    check((get32(&response[7]) & (CSYSPWRUPACK | CDBGPWRUPACK)) == (CSYSPWRUPACK | CDBGPWRUPACK), "power up ack");
+}
+
+static uint8_t *transfer_tar(uint8_t *p, uint32_t addr) {
+    *p++ = ID_DAP_Transfer;
+    *p++ = 0;
+    *p++ = 1;
+    *p++ = AP_REQ(0, AP_TAR);
+    return put32(p, addr);
+}
+
+// Clear the sticky error of an injected bus fault, as a debugger would
+static int recover(uint32_t *retries) {
+    uint8_t *p;
+
+    if ((*retries)++ >= 8) {
+        return 0;
+    }
+    p = request;
+    *p++ = ID_DAP_Transfer;
+    *p++ = 0;
+    *p++ = 1;
+    *p++ = DP_REQ(0, DP_ABORT);
+    put32(p, STKERRCLR);
+    execute(request);
+    return response[2] == DAP_TRANSFER_OK;
+}
+
+static void bench_dp_read(void) {
+    uint32_t i;
+    uint8_t *p;
+    double t;
+
+    p = request;
+    *p++ = ID_DAP_Transfer;
+    *p++ = 0;
+    *p++ = 12;
+    memset(p, DP_REQ(1, DP_IDCODE), 12);
+
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        execute(request);
+        if ((response[1] != 12) || (response[2] != DAP_TRANSFER_OK)) {
+            check(0, "IDCODE block");
+            break;
+        }
+    }
+    report("dp_read", iterations, now() - t);
+}
+
+// RAM block used by iteration i of the block benchmarks, blocks start on a
+// 64 byte grid so that none of them crosses the TAR auto increment boundary
+static uint32_t block_addr(uint32_t i) {
+    return SIM_RAM_START + (i % WINDOW_BLOCKS) * 64;
+}
+
+static uint32_t block_word(uint32_t *pattern, uint32_t i, uint32_t n) {
+    return pattern[(i % WINDOW_BLOCKS) * BLOCK_WORDS + n];
+}
+
+static void bench_block_write(uint32_t *pattern) {
+    uint32_t retries = 0;
+    uint32_t i;
+    uint32_t n;
+    uint8_t *p;
+    double t;
+
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        // Set TAR and write the block in one packet
+        p = request;
+        *p++ = ID_DAP_ExecuteCommands;
+        *p++ = 2;
+        p = transfer_tar(p, block_addr(i));
+        *p++ = ID_DAP_TransferBlock;
+        *p++ = 0;
+        *p++ = BLOCK_WORDS;
+        *p++ = 0;
+        *p++ = AP_REQ(0, AP_DRW);
+        for (n = 0; n < BLOCK_WORDS; n++) {
+            p = put32(p, block_word(pattern, i, n));
+        }
+        execute(request);
+        // ExecuteCommands (2) + Transfer (3) + TransferBlock header (4)
+        if (response[8] != DAP_TRANSFER_OK) {
+            if (!recover(&retries)) {
+                check(0, "block write");
+                break;
+            }
+            i--;
+            continue;
+        }
+        retries = 0;
+    }
+    report("block_write", iterations, now() - t);
+}
+
+static void bench_block_read(uint32_t *pattern) {
+    uint32_t retries = 0;
+    uint32_t i;
+    uint32_t n;
+    uint8_t *p;
+    double t;
+
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        p = request;
+        *p++ = ID_DAP_ExecuteCommands;
+        *p++ = 2;
+        p = transfer_tar(p, block_addr(i));
+        *p++ = ID_DAP_TransferBlock;
+        *p++ = 0;
+        *p++ = BLOCK_WORDS;
+        *p++ = 0;
+        *p++ = AP_REQ(1, AP_DRW);
+        execute(request);
+        if (response[8] != DAP_TRANSFER_OK) {
+            if (!recover(&retries)) {
+                check(0, "block read");
+                break;
+            }
+            i--;
+            continue;
+        }
+        retries = 0;
+        for (n = 0; n < BLOCK_WORDS; n++) {
+            if (get32(&response[9 + n * 4]) != block_word(pattern, i, n)) {
+                break;
+            }
+        }
+        if (n != BLOCK_WORDS) {
+            check(0, "block read data");
+            break;
+        }
+    }
+    report("block_read", iterations, now() - t);
+}
+
+// Block reads must leave TAR right after the last word that was asked for,
+// also when two reads of the same batch share the AP read pipeline
+static void check_block_read_tar(uint32_t *pattern) {
+    uint32_t blocks;
+    uint32_t n;
+    uint8_t *p;
+
+    for (blocks = 1; blocks <= 2; blocks++) {
+        p = request;
+        *p++ = ID_DAP_ExecuteCommands;
+        *p++ = 2 + blocks;
+        p = transfer_tar(p, block_addr(0));
+        for (n = 0; n < blocks; n++) {
+            *p++ = ID_DAP_TransferBlock;
+            *p++ = 0;
+            *p++ = 2;
+            *p++ = 0;
+            *p++ = AP_REQ(1, AP_DRW);
+        }
+        *p++ = ID_DAP_Transfer;
+        *p++ = 0;
+        *p++ = 2;
+        *p++ = AP_REQ(1, AP_DRW);
+        *p++ = AP_REQ(1, AP_TAR);
+        execute(request);
+
+        // ExecuteCommands (2) + Transfer (3), then 4 + 8 bytes per block
+        p = &response[5];
+        for (n = 0; n < blocks * 2; n++) {
+            if ((n % 2) == 0) {
+                check(p[3] == DAP_TRANSFER_OK, "block read for TAR");
+                p += 4;
+            }
+            check(get32(p) == block_word(pattern, 0, n), "block read for TAR data");
+            p += 4;
+        }
+        check((p[1] == 2) && (p[2] == DAP_TRANSFER_OK), "read after block read");
+        check(get32(&p[3]) == block_word(pattern, 0, n), "read after block read data");
+        check(get32(&p[7]) == block_addr(0) + (n + 1) * 4, "TAR after block read");
+    }
+}
+
+static void bench_swd_host(void) {
+    static uint8_t out[HOST_BLOCK_SIZE];
+    static uint8_t in[HOST_BLOCK_SIZE];
+    uint32_t i;
+    uint32_t n;
+    double t;
+
+    for (i = 0; i < sizeof(out); i++) {
+        out[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    check(swd_init_debug(), "swd_init_debug");
+    DAP_SetClock(swj_clock);
+
+    n = iterations / 10 + 1;
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < n; i++) {
+        if (!swd_write_memory(SIM_RAM_START + 0x1000, out, sizeof(out)) ||
+                !swd_read_memory(SIM_RAM_START + 0x1000, in, sizeof(in))) {
+            check(0, "swd_host memory access");
+            break;
+        }
+    }
+    report("swd_host_mem", n * 2, now() - t);
+    check(memcmp(out, in, sizeof(out)) == 0, "swd_host data");
+}
+
+// Flash algorithm calls as target_flash.c makes them for every page
+static void bench_syscall(void) {
+    uint32_t i;
+    uint32_t n;
+    uint32_t addr;
+    double t;
+
+    // Halted in reset as target_flash.c leaves it before the first call
+    check(swd_set_target_state_hw(RESET_PROGRAM), "swd_set_target_state_hw");
+    DAP_SetClock(swj_clock);
+
+    n = iterations / 10 + 1;
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < n; i++) {
+        addr = SIM_FLASH_START + i * sim_algo.program_buffer_size;
+        if (!swd_flash_syscall_exec(&sim_algo.sys_call_s, sim_algo.program_page, addr,
+                                    sim_algo.program_buffer_size, sim_algo.program_buffer, 0)) {
+            check(0, "swd_flash_syscall_exec");
+            break;
+        }
+        if ((sim_target_core_reg(0) != 0) ||
+                (sim_target_core_reg(1) != sim_algo.program_buffer_size) ||
+                (sim_target_core_reg(2) != sim_algo.program_buffer) ||
+                (sim_target_core_reg(9) != sim_algo.sys_call_s.static_base) ||
+                (sim_target_core_reg(13) != sim_algo.sys_call_s.stack_pointer) ||
+                (sim_target_core_reg(14) != sim_algo.sys_call_s.breakpoint) ||
+                (sim_target_core_reg(15) != sim_algo.program_page) ||
+                (sim_target_core_reg(16) != 0x01000000)) {
+            check(0, "swd_flash_syscall_exec registers");
+            break;
+        }
+    }
+    report("syscall", n, now() - t);
+    printf("  %.1f core register writes per call\n", (double)sim_target_stats.core_writes / n);
+}
+
+static uint32_t load_replay(const char *path) {
+    char line[512];
+    char *s;
+    char *end;
+    uint32_t count = 0;
+    FILE *f;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        printf("FAIL: cannot open %s\n", path);
+        failed = 1;
+        return 0;
+    }
+
+    // One command per line in hex, '#' starts a comment
+    while ((count < REPLAY_MAX) && fgets(line, sizeof(line), f)) {
+        s = strchr(line, '#');
+        if (s) {
+            *s = '\0';
+        }
+        replay[count].len = 0;
+        s = line;
+        while (replay[count].len < DAP_PACKET_SIZE) {
+            unsigned long b = strtoul(s, &end, 16);
+            if (end == s) {
+                break;
+            }
+            replay[count].data[replay[count].len++] = (uint8_t)b;
+            s = end;
+        }
+        if (replay[count].len) {
+            count++;
+        }
+    }
+
+    fclose(f);
+    return count;
+}
+
+static void bench_replay(const char *path) {
+    uint32_t count;
+    uint32_t i;
+    uint32_t n;
+    double t;
+
+    count = load_replay(path);
+    if (count == 0) {
+        return;
+    }
+
+    sim_target_stats_clear();
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        for (n = 0; n < count; n++) {
+            memcpy(request, replay[n].data, replay[n].len);
+            execute(request);
+        }
+    }
+    report("replay", iterations * count, now() - t);
+}
+
+static void report_commands(void) {
+#if (DAP_STATS != 0)
+    uint32_t i;
+
+    printf("\nSWCLK cycles per command\n");
+    for (i = 0; i < DAP_STATS_BUCKETS; i++) {
+        if (DAP_Stats.cmd[i].count) {
+            printf("  0x%02X %9u cmds %9.1f clk/cmd\n", i, DAP_Stats.cmd[i].count,
+                   (double)DAP_Stats.cmd[i].cycles / DAP_Stats.cmd[i].count);
+        }
+    }
+#endif
+}
+
+static void usage(void) {
+    printf("usage: swd_bench [-n iterations] [-c swj_clock] [-w period,count] [-f period] [-r reads] [replay_file]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    static uint32_t pattern[WINDOW_BLOCKS * BLOCK_WORDS];
+    sim_target_config_t config;
+    const char *replay_path = NULL;
+    int i;
+
+    memset(&config, 0, sizeof(config));
+    for (i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            iterations = strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+            swj_clock = strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+            if (sscanf(argv[++i], "%u,%u", &config.wait_period, &config.wait_count) != 2) {
+                usage();
+            }
+        } else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc)) {
+            config.fault_period = strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+            config.regrdy_reads = strtoul(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-') {
+            usage();
+        } else {
+            replay_path = argv[i];
+        }
+    }
+
+    for (i = 0; i < WINDOW_BLOCKS * BLOCK_WORDS; i++) {
+        pattern[i] = 0x9E3779B9u * (i + 1);
+    }
+
+    sim_target_init(&config);
+    DAP_Setup();
+    connect();
+
+    if (replay_path) {
+        bench_replay(replay_path);
+    } else {
+        bench_dp_read();
+        bench_block_write(pattern);
+        bench_block_read(pattern);
+        if (config.fault_period == 0) {
+            check_block_read_tar(pattern);
+        }
+    }
+
+    // Command buckets only count DAP commands, swd_host below calls SWD_Transfer directly
+    report_commands();
+
+    // swd_host.c gives up on the first FAULT, so it only runs without faults
+    if ((replay_path == NULL) && (config.fault_period == 0)) {
+        bench_swd_host();
+        bench_syscall();
+    }
+
+    if (failed) {
+        printf("\nFAILED\n");
+        return 1;
+    }
+    printf("\nPASSED\n");
+    return 0;
+}
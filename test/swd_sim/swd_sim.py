@@ -0,0 +1,99 @@
+"""
+CMSIS-DAP Interface Firmware
+Copyright (c) 2009-2013 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Host simulation of the CMSIS-DAP SWD engine
+
+Builds DAP.c, SW_DP.c and swd_host.c with the host compiler against the
+virtual SWD target in this directory and runs the benchmark. Arguments after
+the options are passed to the benchmark:
+
+  -n iterations       packets per benchmark (default 1000)
+  -c swj_clock        SWJ clock requested with DAP_SWJ_Clock
+  -w period,count     answer every period-th AP access with count WAITs
+  -f period           fail every period-th memory access with a bus error
+  -r reads            keep S_REGRDY clear for reads DHCSR reads per core register
+  replay_file         replay DAP commands, one hex encoded command per line
+
+Exits non zero if the build fails or the benchmark finds a wrong response.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+
+SIM_DIR = os.path.dirname(os.path.abspath(__file__))
+ROOT_DIR = os.path.normpath(os.path.join(SIM_DIR, "..", ".."))
+SOURCE_DIR = os.path.join(ROOT_DIR, "source")
+
+SOURCES = [
+    os.path.join(SIM_DIR, "swd_bench.c"),
+    os.path.join(SIM_DIR, "swd_target.c"),
+    os.path.join(SOURCE_DIR, "daplink", "cmsis-dap", "DAP.c"),
+    os.path.join(SOURCE_DIR, "daplink", "cmsis-dap", "SW_DP.c"),
+    os.path.join(SOURCE_DIR, "daplink", "interface", "swd_host.c"),
+]
+
+# The simulation directory comes first so its DAP_config.h and RTL.h
+# replace the HDK and RTX headers
+INCLUDES = [
+    SIM_DIR,
+    os.path.join(SOURCE_DIR, "daplink", "cmsis-dap"),
+    os.path.join(SOURCE_DIR, "daplink", "interface"),
+    os.path.join(SOURCE_DIR, "daplink"),
+    os.path.join(SOURCE_DIR, "hdk_hal"),
+]
+
+
+def build(cc, build_dir, cflags):
+    if not os.path.isdir(build_dir):
+        os.makedirs(build_dir)
+    exe = os.path.join(build_dir, "swd_bench")
+    cmd = [cc, "-O2", "-Wall", "-o", exe]
+    cmd += cflags
+    cmd += ["-I" + path for path in INCLUDES]
+    cmd += SOURCES
+    print("#> " + " ".join(cmd))
+    subprocess.check_call(cmd)
+    return exe
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CMSIS-DAP SWD engine host simulation")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"),
+                        help="Host C compiler")
+    parser.add_argument("--build-dir", default=os.path.join(ROOT_DIR, "projectfiles", "host", "swd_sim"),
+                        help="Output directory for the benchmark")
+    parser.add_argument("--cflags", default="",
+                        help="Extra compiler flags, for example \"-DDAP_STATS=0\"")
+    parser.add_argument("--nobuild", action="store_true",
+                        help="Run the benchmark that was built already")
+    args, bench_args = parser.parse_known_args()
+
+    exe = os.path.join(args.build_dir, "swd_bench")
+    if not args.nobuild:
+        try:
+            exe = build(args.cc, args.build_dir, args.cflags.split())
+        except (OSError, subprocess.CalledProcessError) as e:
+            print("#> Build failed: %s" % e)
+            return 1
+
+    return subprocess.call([exe] + bench_args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,565 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "DAP_config.h"
+#include "swd_target.h"
+#include "debug_cm.h"
+
+// Virtual SW-DP with one AHB-AP in front of flash, RAM and the core debug
+// registers. The wire protocol is decoded bit by bit on the SWCLK rising edge,
+// exactly where a real target samples SWDIO and starts driving the next bit.
+
+#define ACK_OK              0x1
+#define ACK_WAIT            0x2
+#define ACK_FAULT           0x4
+
+#define TURNAROUND          1               // Target side, matches the DAP default
+#define LINE_RESET_ONES     50
+#define TAR_WRAP            0x1000          // Auto increment boundary, see swd_host.c
+
+#define SCS_AIRCR           0xE000ED0C
+#define SCS_DHCSR           0xE000EDF0
+#define SCS_DCRSR           0xE000EDF4
+#define SCS_DCRDR           0xE000EDF8
+#define SCS_DEMCR           0xE000EDFC
+#define PPB_START           0xE0000000
+#define PPB_END             0xE0100000
+
+typedef enum {
+    ST_RESET,               // After line reset, waiting for an idle cycle
+    ST_IDLE,
+    ST_HEADER,
+    ST_TRN_ACK,
+    ST_ACK,
+    ST_RDATA,
+    ST_TRN_WDATA,
+    ST_WDATA,
+    ST_TRN_IDLE,
+    ST_LOCKOUT,             // Protocol error, only a line reset recovers
+} sim_state_t;
+
+sim_target_stats_t sim_target_stats;
+uint8_t sim_flash[SIM_FLASH_SIZE];
+uint8_t sim_ram[SIM_RAM_SIZE];
+
+// Read by DAP_StatsTimer() in place of the RTX tick, so the command counters
+// of the engine report SWCLK cycles.
+uint32_t os_time;
+
+// Never started by the benchmark, only SWJ_Pins with a wait time touches it
+SysTick_Type sim_systick;
+
+static sim_target_config_t config;
+
+// Wire state
+static uint32_t swclk;
+static uint32_t host_out;
+static uint32_t host_oe;
+static uint32_t target_out;
+static uint32_t target_oe;
+static uint32_t nreset = 1;
+static sim_state_t state;
+static uint32_t ones;
+static uint32_t idx;
+static uint32_t header;
+static uint32_t ack;
+static uint32_t data;
+
+// DP and AP registers
+static uint32_t ctrl_stat;
+static uint32_t sticky;
+static uint32_t dp_select;
+static uint32_t read_buf;
+static uint32_t csw;
+static uint32_t tar;
+static uint32_t ap_count;
+static uint32_t stall;
+static uint32_t mem_count;
+
+// Core debug
+static uint32_t dhcsr;
+static uint32_t dcrdr;
+static uint32_t demcr;
+static uint32_t core_regs[32];
+static uint32_t halted;
+static uint32_t regrdy_busy;
+
+static uint32_t parity32(uint32_t val) {
+    val ^= val >> 16;
+    val ^= val >> 8;
+    val ^= val >> 4;
+    val ^= val >> 2;
+    val ^= val >> 1;
+    return val & 1;
+}
+
+static uint32_t scs_read(uint32_t addr) {
+    switch (addr) {
+        case SCS_AIRCR:
+            return 0xFA050000;
+        case SCS_DHCSR:
+            if (regrdy_busy) {
+                regrdy_busy--;
+                return dhcsr | (halted ? S_HALT : 0);
+            }
+            return dhcsr | S_REGRDY | (halted ? S_HALT : 0);
+        case SCS_DCRDR:
+            return dcrdr;
+        case SCS_DEMCR:
+            return demcr;
+        default:
+            return 0;
+    }
+}
+
+static void scs_write(uint32_t addr, uint32_t val) {
+    switch (addr) {
+        case SCS_AIRCR:
+            if (((val >> 16) == 0x05FA) && (val & (SYSRESETREQ | VECTRESET))) {
+                halted = (demcr & VC_CORERESET) ? 1 : 0;
+            }
+            break;
+        case SCS_DHCSR:
+            if ((val & 0xFFFF0000) != DBGKEY) {
+                break;
+            }
+            dhcsr = val & (C_DEBUGEN | C_HALT | C_STEP | C_MASKINTS);
+            if (dhcsr & C_HALT) {
+                halted = 1;
+            } else if (halted) {
+                // No instructions are simulated: a resumed flash algorithm
+                // returns to its breakpoint at once and reports success.
+                core_regs[0] = 0;
+            }
+            break;
+        case SCS_DCRSR:
+            if (val & (1 << 16)) {
+                core_regs[val & 0x1F] = dcrdr;
+                sim_target_stats.core_writes++;
+            } else {
+                dcrdr = core_regs[val & 0x1F];
+            }
+            regrdy_busy = config.regrdy_reads;
+            break;
+        case SCS_DCRDR:
+            dcrdr = val;
+            break;
+        case SCS_DEMCR:
+            demcr = val;
+            break;
+        default:
+            break;
+    }
+}
+
+// Single access on the AHB behind the AP, returns 0 on a bus error
+static uint32_t mem_access(uint32_t addr, uint32_t size, uint32_t write, uint32_t *val) {
+    uint8_t *mem;
+    uint32_t lane;
+    uint32_t word;
+
+    mem_count++;
+    if (config.fault_period && ((mem_count % config.fault_period) == 0)) {
+        return 0;
+    }
+
+    if ((addr >= PPB_START) && (addr < PPB_END)) {
+        if (write) {
+            scs_write(addr & ~3, *val);
+        } else {
+            *val = scs_read(addr & ~3);
+        }
+        return 1;
+    }
+
+    if ((addr >= SIM_RAM_START) && (addr < (SIM_RAM_START + SIM_RAM_SIZE))) {
+        mem = &sim_ram[(addr - SIM_RAM_START) & ~3];
+    } else if (!write && (addr >= SIM_FLASH_START) && (addr < (SIM_FLASH_START + SIM_FLASH_SIZE))) {
+        mem = &sim_flash[(addr - SIM_FLASH_START) & ~3];
+    } else {
+        return 0;
+    }
+
+    word = mem[0] | (mem[1] << 8) | (mem[2] << 16) | ((uint32_t)mem[3] << 24);
+    lane = (addr & 3) * 8;
+    if (!write) {
+        *val = word;
+        return 1;
+    }
+
+    switch (size) {
+        case CSW_SIZE8:
+            word = (word & ~(0xFFu << lane)) | (*val & (0xFFu << lane));
+            break;
+        case CSW_SIZE16:
+            lane &= 16;
+            word = (word & ~(0xFFFFu << lane)) | (*val & (0xFFFFu << lane));
+            break;
+        default:
+            word = *val;
+            break;
+    }
+    mem[0] = (uint8_t)(word >> 0);
+    mem[1] = (uint8_t)(word >> 8);
+    mem[2] = (uint8_t)(word >> 16);
+    mem[3] = (uint8_t)(word >> 24);
+    return 1;
+}
+
+static uint32_t ap_access(uint32_t reg, uint32_t write, uint32_t val) {
+    uint32_t addr;
+    uint32_t size;
+
+    if ((dp_select & APSEL) != 0) {
+        return 0;
+    }
+
+    reg |= dp_select & APBANKSEL;
+    switch (reg) {
+        case AP_CSW:
+            if (write) {
+                csw = val & ~(CSW_DBGSTAT | CSW_TINPROG);
+            }
+            return csw | CSW_DBGSTAT;
+        case AP_TAR:
+            if (write) {
+                tar = val;
+            }
+            return tar;
+        case AP_DRW:
+        case AP_BD0:
+        case AP_BD1:
+        case AP_BD2:
+        case AP_BD3:
+            addr = (reg == AP_DRW) ? tar : ((tar & ~0xF) | (reg & 0xC));
+            size = csw & CSW_SIZE;
+            if (!mem_access(addr, size, write, &val)) {
+                sticky |= STICKYERR;
+                return 0;
+            }
+            if ((reg == AP_DRW) && ((csw & CSW_ADDRINC) == CSW_SADDRINC)) {
+                tar = (tar & ~(TAR_WRAP - 1)) | ((tar + (1 << size)) & (TAR_WRAP - 1));
+            }
+            return val;
+        case AP_ROM:
+            return 0xE00FF003;
+        case AP_IDR:
+            return SIM_AP_IDR;
+        default:
+            return 0;
+    }
+}
+
+static uint32_t dp_read(uint32_t reg) {
+    switch (reg) {
+        case DP_IDCODE:
+            return SIM_IDCODE;
+        case DP_CTRL_STAT:
+            return ctrl_stat | sticky | ((ctrl_stat & (CDBGPWRUPREQ | CSYSPWRUPREQ)) << 1);
+        case DP_RESEND:
+        case DP_RDBUFF:
+        default:
+            return read_buf;
+    }
+}
+
+static void dp_write(uint32_t reg, uint32_t val) {
+    switch (reg) {
+        case DP_ABORT:
+            if (val & STKCMPCLR) {
+                sticky &= ~STICKYCMP;
+            }
+            if (val & STKERRCLR) {
+                sticky &= ~STICKYERR;
+            }
+            if (val & WDERRCLR) {
+                sticky &= ~WDATAERR;
+            }
+            if (val & ORUNERRCLR) {
+                sticky &= ~STICKYORUN;
+            }
+            break;
+        case DP_CTRL_STAT:
+            ctrl_stat = val & (CSYSPWRUPREQ | CDBGPWRUPREQ | CDBGRSTREQ | MASKLANE | TRNMODE | ORUNDETECT);
+            break;
+        case DP_SELECT:
+            dp_select = val;
+            break;
+        default:
+            break;
+    }
+}
+
+// Decide the acknowledge of a decoded request, reads are performed here
+static uint32_t request_ack(void) {
+    uint32_t ap = (header >> 1) & 1;
+    uint32_t rnw = (header >> 2) & 1;
+    uint32_t reg = ((header >> 3) & 3) << 2;
+
+    // Only IDCODE and CTRL/STAT reads and ABORT writes pass a sticky error
+    if (sticky & (STICKYERR | STICKYCMP | STICKYORUN | WDATAERR)) {
+        if (ap || (rnw && (reg != DP_IDCODE) && (reg != DP_CTRL_STAT)) || (!rnw && (reg != DP_ABORT))) {
+            return ACK_FAULT;
+        }
+    }
+
+    if (ap && config.wait_period) {
+        if ((stall == 0) && (++ap_count >= config.wait_period)) {
+            ap_count = 0;
+            stall = config.wait_count;
+        }
+        if (stall) {
+            stall--;
+            return ACK_WAIT;
+        }
+    }
+
+    if (rnw) {
+        if (ap) {
+            // AP reads are posted, the result of this one is returned next time
+            data = read_buf;
+            read_buf = ap_access(reg, 0, 0);
+        } else {
+            data = dp_read(reg);
+        }
+    }
+
+    return ACK_OK;
+}
+
+static void request_write(void) {
+    uint32_t reg = ((header >> 3) & 3) << 2;
+
+    if ((header >> 1) & 1) {
+        ap_access(reg, 1, data);
+    } else {
+        dp_write(reg, data);
+    }
+}
+
+static void swclk_rising(void) {
+    uint32_t line;
+
+    sim_target_stats.swclk_cycles++;
+    os_time++;
+
+    if (host_oe) {
+        line = host_out;
+        if (line) {
+            if (++ones == LINE_RESET_ONES) {
+                sim_target_stats.line_resets++;
+                state = ST_RESET;
+                target_oe = 0;
+            }
+        } else {
+            ones = 0;
+        }
+    } else {
+        line = target_oe ? target_out : 1;
+        ones = 0;
+    }
+
+    switch (state) {
+        case ST_RESET:
+            if (host_oe && !line) {
+                state = ST_IDLE;
+            }
+            break;
+
+        case ST_IDLE:
+            if (host_oe && line) {
+                header = 1;
+                idx = 1;
+                state = ST_HEADER;
+            }
+            break;
+
+        case ST_HEADER:
+            header |= line << idx;
+            if (++idx < 8) {
+                break;
+            }
+            // Start, APnDP, RnW, A[3:2], Parity, Stop, Park
+            if ((((header >> 5) & 1) != parity32((header >> 1) & 0xF)) ||
+                    (header & (1 << 6)) || !(header & (1 << 7))) {
+                sim_target_stats.protocol++;
+                state = ST_LOCKOUT;
+                break;
+            }
+            sim_target_stats.requests++;
+            idx = TURNAROUND;
+            state = ST_TRN_ACK;
+            break;
+
+        case ST_TRN_ACK:
+            if (--idx) {
+                break;
+            }
+            ack = request_ack();
+            target_oe = 1;
+            target_out = ack & 1;
+            idx = 1;
+            state = ST_ACK;
+            break;
+
+        case ST_ACK:
+            if (idx < 3) {
+                target_out = (ack >> idx) & 1;
+                idx++;
+                break;
+            }
+            if (ack == ACK_OK) {
+                sim_target_stats.ok++;
+                if ((header >> 2) & 1) {
+                    target_out = data & 1;
+                    idx = 1;
+                    state = ST_RDATA;
+                } else {
+                    target_oe = 0;
+                    idx = TURNAROUND;
+                    state = ST_TRN_WDATA;
+                }
+            } else {
+                if (ack == ACK_WAIT) {
+                    sim_target_stats.wait++;
+                } else {
+                    sim_target_stats.fault++;
+                }
+                target_oe = 0;
+                idx = TURNAROUND;
+                state = ST_TRN_IDLE;
+            }
+            break;
+
+        case ST_RDATA:
+            if (idx < 32) {
+                target_out = (data >> idx) & 1;
+                idx++;
+            } else if (idx == 32) {
+                target_out = parity32(data);
+                idx++;
+            } else {
+                target_oe = 0;
+                idx = TURNAROUND;
+                state = ST_TRN_IDLE;
+            }
+            break;
+
+        case ST_TRN_WDATA:
+            if (--idx == 0) {
+                data = 0;
+                state = ST_WDATA;
+            }
+            break;
+
+        case ST_WDATA:
+            if (idx < 32) {
+                data |= line << idx;
+                idx++;
+                break;
+            }
+            if (line != parity32(data)) {
+                sticky |= WDATAERR;
+            } else {
+                request_write();
+            }
+            state = ST_IDLE;
+            break;
+
+        case ST_TRN_IDLE:
+            if (--idx == 0) {
+                state = ST_IDLE;
+            }
+            break;
+
+        case ST_LOCKOUT:
+        default:
+            break;
+    }
+}
+
+void sim_target_init(const sim_target_config_t *cfg) {
+    memset(&config, 0, sizeof(config));
+    if (cfg) {
+        config = *cfg;
+    }
+
+    state = ST_LOCKOUT;
+    target_oe = 0;
+    ones = 0;
+    ctrl_stat = 0;
+    sticky = 0;
+    dp_select = 0;
+    read_buf = 0;
+    csw = 0;
+    tar = 0;
+    ap_count = 0;
+    stall = 0;
+    mem_count = 0;
+    dhcsr = 0;
+    dcrdr = 0;
+    demcr = 0;
+    halted = 0;
+    regrdy_busy = 0;
+    memset(core_regs, 0, sizeof(core_regs));
+    sim_target_stats_clear();
+}
+
+uint32_t sim_target_core_reg(uint32_t n) {
+    return core_regs[n & 0x1F];
+}
+
+void sim_target_stats_clear(void) {
+    memset(&sim_target_stats, 0, sizeof(sim_target_stats));
+}
+
+void sim_swclk(uint32_t level) {
+    if (level && !swclk) {
+        swclk_rising();
+    }
+    swclk = level;
+}
+
+uint32_t sim_swclk_in(void) {
+    return swclk;
+}
+
+void sim_swdio_out(uint32_t bit) {
+    host_out = bit & 1;
+}
+
+void sim_swdio_oe(uint32_t enable) {
+    host_oe = enable;
+}
+
+uint32_t sim_swdio_in(void) {
+    if (host_oe) {
+        return host_out;
+    }
+    return target_oe ? target_out : 1;
+}
+
+void sim_nreset_out(uint32_t bit) {
+    if (bit && !nreset) {
+        halted = (demcr & VC_CORERESET) ? 1 : 0;
+    }
+    nreset = bit & 1;
+}
+
+uint32_t sim_nreset_in(void) {
+    return nreset;
+}
@@ -0,0 +1,65 @@
+/* CMSIS-DAP Interface Firmware
+ * Copyright (c) 2009-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SWD_TARGET_H
+#define SWD_TARGET_H
+
+#include <stdint.h>
+
+// Memory map of the virtual target
+#define SIM_FLASH_START     0x00000000
+#define SIM_FLASH_SIZE      0x00020000      // Read only over the MEM-AP
+#define SIM_RAM_START       0x20000000
+#define SIM_RAM_SIZE        0x00010000
+#define SIM_IDCODE          0x2BA01477      // Cortex-M3/M4 SW-DP
+#define SIM_AP_IDR          0x24770011      // AHB-AP
+
+typedef struct {
+    uint32_t wait_period;       // Every Nth AP access is stalled (0 = never)
+    uint32_t wait_count;        // Number of WAIT responses per stall
+    uint32_t fault_period;      // Every Nth memory access raises a bus error (0 = never)
+    uint32_t regrdy_reads;      // DHCSR reads without S_REGRDY after a DCRSR write
+} sim_target_config_t;
+
+typedef struct {
+    uint32_t swclk_cycles;      // SWCLK rising edges
+    uint32_t requests;          // Packet requests decoded
+    uint32_t ok;                // OK acknowledges
+    uint32_t wait;              // WAIT acknowledges
+    uint32_t fault;             // FAULT acknowledges
+    uint32_t protocol;          // Requests dropped for a protocol error
+    uint32_t line_resets;       // Line resets detected
+    uint32_t core_writes;       // Core register writes through DCRSR
+} sim_target_stats_t;
+
+extern sim_target_stats_t sim_target_stats;
+extern uint8_t sim_flash[SIM_FLASH_SIZE];
+extern uint8_t sim_ram[SIM_RAM_SIZE];
+
+void sim_target_init(const sim_target_config_t *config);
+void sim_target_stats_clear(void);
+uint32_t sim_target_core_reg(uint32_t n);
+
+// Pin layer used by the simulated DAP_config.h
+void sim_swclk(uint32_t level);
+uint32_t sim_swclk_in(void);
+void sim_swdio_out(uint32_t bit);
+void sim_swdio_oe(uint32_t enable);
+uint32_t sim_swdio_in(void);
+void sim_nreset_out(uint32_t bit);
+uint32_t sim_nreset_in(void);
+
+#endif
@@ -0,0 +1,170 @@
+#
+# CMSIS-DAP Interface Firmware
+# Copyright (c) 2009-2013 ARM Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""
+Pack an image into the compressed drag-n-drop format (.lz)
+
+The file starts with a 16 byte header followed by LZ77 tokens:
+
+  offset 0   magic "DLZ\\x01"
+  offset 4   target address, 32 bit little endian
+  offset 8   image size, 32 bit little endian
+  offset 12  window bits, the decoder keeps (1 << window bits) bytes
+  offset 13  reserved, 0
+
+  0x00-0x7F  literal run, the next (token + 1) bytes are copied
+  0x80-0xFF  match of ((token & 0x7F) + 3) bytes starting (offset + 1)
+             bytes back, offset is 2 bytes little endian
+
+Gaps in a hex file are filled with 0xFF.  The interface firmware accepts a
+window of up to 10 bits, or 8 bits on the HDKs with little RAM (LPC11U35,
+K20DX and KL26Z).  Files for those have to be packed with -w 8.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"DLZ\x01"
+HEADER_FORMAT = "<4sIIB3x"
+MAX_LITERAL = 0x80
+MIN_MATCH = 3
+MAX_MATCH = 0x7F + MIN_MATCH
+MAX_CHAIN = 16
+
+
+def compress(data, window_bits):
+    window = 1 << window_bits
+    size = len(data)
+    out = bytearray()
+    literals = bytearray()
+    chains = {}
+
+    def flush_literals():
+        if literals:
+            out.append(len(literals) - 1)
+            out.extend(literals)
+            del literals[:]
+
+    def insert(pos):
+        if pos + MIN_MATCH <= size:
+            chain = chains.setdefault(bytes(data[pos:pos + MIN_MATCH]), [])
+            chain.append(pos)
+            if len(chain) > MAX_CHAIN:
+                del chain[0]
+
+    pos = 0
+    while pos < size:
+        best_len = 0
+        best_dist = 0
+        limit = min(MAX_MATCH, size - pos)
+        if limit >= MIN_MATCH:
+            for cand in reversed(chains.get(bytes(data[pos:pos + MIN_MATCH]), [])):
+                dist = pos - cand
+                if dist > window:
+                    break
+                length = MIN_MATCH
+                while length < limit and data[cand + length] == data[pos + length]:
+                    length += 1
+                if length > best_len:
+                    best_len = length
+                    best_dist = dist
+                    if length == limit:
+                        break
+
+        if best_len >= MIN_MATCH:
+            flush_literals()
+            out.append(0x80 | (best_len - MIN_MATCH))
+            out.extend(struct.pack("<H", best_dist - 1))
+            for i in range(pos, pos + best_len):
+                insert(i)
+            pos += best_len
+        else:
+            literals.append(data[pos])
+            if len(literals) == MAX_LITERAL:
+                flush_literals()
+            insert(pos)
+            pos += 1
+    flush_literals()
+    return out
+
+
+def decompress(packed):
+    magic, address, size, window_bits = struct.unpack(HEADER_FORMAT, bytes(packed[:16]))
+    if magic != MAGIC:
+        raise Exception("Bad magic")
+    out = bytearray()
+    pos = 16
+    while len(out) < size:
+        token = packed[pos]
+        pos += 1
+        if token & 0x80:
+            offset = packed[pos] | (packed[pos + 1] << 8)
+            pos += 2
+            for _ in range((token & 0x7F) + MIN_MATCH):
+                out.append(out[-offset - 1])
+        else:
+            out.extend(packed[pos:pos + token + 1])
+            pos += token + 1
+    return address, out
+
+
+def load_image(filename, address):
+    if filename.lower().endswith(".hex"):
+        from intelhex import IntelHex
+        ihex = IntelHex(filename)
+        start = ihex.minaddr()
+        return start, bytearray(ihex.tobinstr(start=start, end=ihex.maxaddr()))
+    if address is None:
+        raise Exception("--address is required for binary files")
+    with open(filename, "rb") as f:
+        return address, bytearray(f.read())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack an image into the compressed drag-n-drop format")
+    parser.add_argument("image", help="Binary or hex file to pack")
+    parser.add_argument("-o", "--output", help="Output file, defaults to the image name with a .lz extension")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0),
+                        help="Target address of a binary file")
+    parser.add_argument("-w", "--window-bits", type=int, default=10,
+                        help="Window size in bits, 8 to 10 (default 10)")
+    args = parser.parse_args()
+
+    if not 8 <= args.window_bits <= 10:
+        print("Window bits must be between 8 and 10")
+        return 1
+
+    address, data = load_image(args.image, args.address)
+    packed = bytearray(struct.pack(HEADER_FORMAT, MAGIC, address, len(data), args.window_bits))
+    packed += compress(data, args.window_bits)
+
+    # Make sure the result decodes back to the image
+    if decompress(packed) != (address, data):
+        print("Packed image does not match the input")
+        return 1
+
+    output = args.output or os.path.splitext(args.image)[0] + ".lz"
+    with open(output, "wb") as f:
+        f.write(packed)
+    print("%s: 0x%x, %i -> %i bytes" % (output, address, len(data), len(packed)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
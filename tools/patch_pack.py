@@ -0,0 +1,281 @@
+#
+# CMSIS-DAP Interface Firmware
+# Copyright (c) 2009-2013 ARM Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""
+Make a drag-n-drop patch (.pat) that turns the image on the target into a new one
+
+The file starts with a 32 byte header followed by ops:
+
+  offset 0   magic "DPT\\x01"
+  offset 4   target address of both images, 32 bit little endian
+  offset 8   old image size
+  offset 12  CRC32 of the old image
+  offset 16  new image size
+  offset 20  CRC32 of the new image
+  offset 24  flash sector size the patch was made for
+  offset 28  block size the patch was made for, 0 means 1024
+
+  0x00-0x7F  literal run, the next (op + 1) bytes are copied
+  0x80-0xFF  copy of ((((op & 0x7F) << 8) | next byte) + 1) bytes of the
+             old image starting at the 4 byte little endian offset after it
+
+The interface firmware rebuilds the new image a block at a time and programs
+it over the old one, erasing each sector just before its first block is
+written.  A block may only copy from the part of the old image that is
+still intact: from the start of the block if it starts a sector, otherwise
+from the next sector.  A copy of whole sectors onto themselves that starts
+a block is not programmed at all, so sectors that do not change keep their
+contents.  The sector size must be a multiple of the target's erase sector
+size.  Gaps in a hex file are filled with 0xFF.
+
+The block size must match the interface firmware: 1024 bytes, or 256 bytes
+on the HDKs with little RAM (LPC11U35, K20DX and KL26Z).  Patches for those
+have to be made with -b 256.
+"""
+from __future__ import print_function
+
+import argparse
+import bisect
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"DPT\x01"
+HEADER_FORMAT = "<4sIIIIIII"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+DEFAULT_BLOCK_SIZE = 1024
+MAX_LITERAL = 0x80
+MAX_COPY = 0x8000
+MIN_COPY = 8
+MAX_CHAIN = 16
+
+
+def crc32(data):
+    return zlib.crc32(bytes(data)) & 0xFFFFFFFF
+
+
+def intact_offset(block, address, sector_size):
+    """First offset of the old image that is intact while block is rebuilt"""
+    addr = address + block
+    if addr % sector_size:
+        addr += sector_size - addr % sector_size
+    return addr - address
+
+
+def match_length(base, src, new, pos, limit):
+    length = 0
+    while length + 64 <= limit and base[src + length:src + length + 64] == new[pos + length:pos + length + 64]:
+        length += 64
+    while length < limit and base[src + length] == new[pos + length]:
+        length += 1
+    return length
+
+
+def copy_op(length, src):
+    return bytearray([0x80 | ((length - 1) >> 8), (length - 1) & 0xFF]) + struct.pack("<I", src)
+
+
+def diff(base, new, address, sector_size, block_size):
+    out = bytearray()
+    literals = bytearray()
+    index = {}
+
+    for i in range(len(base) - MIN_COPY + 1):
+        index.setdefault(bytes(base[i:i + MIN_COPY]), []).append(i)
+
+    def flush_literals():
+        if literals:
+            out.append(len(literals) - 1)
+            out.extend(literals)
+            del literals[:]
+
+    pos = 0
+    block = 0
+    while pos < len(new):
+        if pos - block == block_size:
+            block = pos
+
+        # Sectors that do not change are copied onto themselves and skipped
+        if pos == block and (address + pos) % sector_size == 0:
+            end = min(len(new), len(base), pos + MAX_COPY)
+            length = 0
+            while (pos + length + sector_size <= end and
+                   new[pos + length:pos + length + sector_size] == base[pos + length:pos + length + sector_size]):
+                length += sector_size
+            if length:
+                flush_literals()
+                out += copy_op(length, pos)
+                pos += length
+                block = pos
+                continue
+
+        intact = intact_offset(block, address, sector_size)
+        block_left = block + block_size - pos
+
+        # The same offset is the most likely match, then the hash chain
+        candidates = []
+        if intact <= pos < len(base):
+            candidates.append(pos)
+        chain = index.get(bytes(new[pos:pos + MIN_COPY]), [])
+        first = bisect.bisect_left(chain, intact)
+        candidates.extend(chain[first:first + MAX_CHAIN])
+
+        best_len = 0
+        best_src = 0
+        for src in candidates:
+            limit = min(block_left, len(new) - pos, len(base) - src)
+            length = match_length(base, src, new, pos, limit)
+            if length > best_len:
+                best_len = length
+                best_src = src
+                if length == limit:
+                    break
+
+        if best_len >= MIN_COPY:
+            flush_literals()
+            out += copy_op(best_len, best_src)
+            pos += best_len
+        else:
+            literals.append(new[pos])
+            if len(literals) == MAX_LITERAL:
+                flush_literals()
+            pos += 1
+    flush_literals()
+    return out
+
+
+def apply_patch(patch, base, erased_value=0xFF):
+    """Apply the patch the way the interface firmware does, erasing in place"""
+    magic, address, base_size, base_crc, size, new_crc, sector_size, block_size = \
+        struct.unpack(HEADER_FORMAT, bytes(patch[:HEADER_SIZE]))
+    block_size = block_size or DEFAULT_BLOCK_SIZE
+    if magic != MAGIC or base_size != len(base) or crc32(base) != base_crc:
+        raise Exception("Patch does not match the old image")
+    flash = bytearray(base) + bytearray([erased_value]) * max(0, size - len(base))
+    flash += bytearray([erased_value]) * (-(address + len(flash)) % sector_size)
+    erased = set()
+    rebuilt = bytearray()
+    block = bytearray()
+    block_addr = 0
+    pos = HEADER_SIZE
+
+    def program():
+        for addr in range(block_addr, block_addr + len(block)):
+            sector = (address + addr) // sector_size
+            if sector not in erased:
+                erased.add(sector)
+                start = sector * sector_size - address
+                flash[max(start, 0):start + sector_size] = \
+                    bytearray([erased_value]) * (start + sector_size - max(start, 0))
+        flash[block_addr:block_addr + len(block)] = block
+
+    while len(rebuilt) < size:
+        op = patch[pos]
+        if op & 0x80:
+            length = (((op & 0x7F) << 8) | patch[pos + 1]) + 1
+            src = struct.unpack("<I", bytes(patch[pos + 2:pos + 6]))[0]
+            pos += 6
+            if length > size - len(rebuilt) or src + length > base_size:
+                raise Exception("Copy out of range")
+            if (not block and src == block_addr and (address + block_addr) % sector_size == 0 and
+                    length >= sector_size):
+                skip = length - length % sector_size
+                rebuilt += flash[src:src + skip]
+                block_addr += skip
+                src += skip
+                length -= skip
+            data = None
+        else:
+            length = op + 1
+            data = patch[pos + 1:pos + length + 1]
+            pos += length + 1
+        while length:
+            chunk = min(length, block_size - len(block))
+            if data is None:
+                if src < intact_offset(block_addr, address, sector_size):
+                    raise Exception("Copy from an erased sector")
+                block += flash[src:src + chunk]
+                src += chunk
+            else:
+                block += data[:chunk]
+                data = data[chunk:]
+            rebuilt += block[-chunk:]
+            length -= chunk
+            if len(block) == block_size or len(rebuilt) == size:
+                program()
+                block_addr += len(block)
+                block = bytearray()
+    if crc32(rebuilt) != new_crc:
+        raise Exception("CRC of the new image does not match")
+    return flash[:size]
+
+
+def load_image(filename, address):
+    if filename.lower().endswith(".hex"):
+        from intelhex import IntelHex
+        ihex = IntelHex(filename)
+        start = ihex.minaddr()
+        return start, bytearray(ihex.tobinstr(start=start, end=ihex.maxaddr()))
+    if address is None:
+        raise Exception("--address is required for binary files")
+    with open(filename, "rb") as f:
+        return address, bytearray(f.read())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Make a drag-n-drop patch between two images")
+    parser.add_argument("old", help="Binary or hex file on the target now")
+    parser.add_argument("new", help="Binary or hex file to program")
+    parser.add_argument("-o", "--output", help="Output file, defaults to the new image name with a .pat extension")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0),
+                        help="Target address of binary files")
+    parser.add_argument("-s", "--sector-size", type=lambda x: int(x, 0), required=True,
+                        help="Flash erase sector size of the target")
+    parser.add_argument("-b", "--block-size", type=lambda x: int(x, 0), default=DEFAULT_BLOCK_SIZE,
+                        help="Block size of the interface firmware (default %i)" % DEFAULT_BLOCK_SIZE)
+    args = parser.parse_args()
+
+    old_address, old = load_image(args.old, args.address)
+    address, new = load_image(args.new, args.address)
+    if old_address != address:
+        print("Both images must start at the same address")
+        return 1
+    if args.sector_size <= 0:
+        print("Sector size must be positive")
+        return 1
+    if args.block_size <= 0:
+        print("Block size must be positive")
+        return 1
+
+    patch = bytearray(struct.pack(HEADER_FORMAT, MAGIC, address, len(old), crc32(old),
+                                  len(new), crc32(new), args.sector_size, args.block_size))
+    patch += diff(old, new, address, args.sector_size, args.block_size)
+
+    # Make sure the patch rebuilds the new image
+    if apply_patch(patch, old) != new:
+        print("Patch does not rebuild the new image")
+        return 1
+
+    output = args.output or os.path.splitext(args.new)[0] + ".pat"
+    with open(output, "wb") as f:
+        f.write(patch)
+    print("%s: 0x%x, %i -> %i bytes" % (output, address, len(new), len(patch)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())